@@ -7,25 +7,147 @@
 #include <chrono>
 #include <stdlib.h>
 #include <stdio.h>
+#include <algorithm>
+#include <math.h>
 
 //windows required api
 #ifndef __MAC_OS_X_VERSION_MAX_ALLOWED
   #include <Windows.h>
   #include <shlobj.h>
-  #include <algorithm>
 #endif
 
 using namespace openS3;
 
+//SQLite table names are case insensitive, so caches are keyed by the
+//uppercased name (CreateTable stores tables uppercased as well).
+static string TableKey(const string & tableName)
+{
+	string key(tableName);
+	transform(key.begin(), key.end(), key.begin(), ::toupper);
+	return key;
+}
+
+static const char* ColumnTypeName(ColumnType type)
+{
+	switch (type)
+	{
+	case ColumnInteger: return "INTEGER";
+	case ColumnReal: return "REAL";
+	case ColumnBlob: return "BLOB";
+	default: return "TEXT";
+	}
+}
+
+//Key lists go out as IN lists padded (with the last key) up to one of a few
+//sizes, so only a handful of statements reach the statement cache
+static size_t InListShape(size_t keys)
+{
+	static const size_t shapes[] = { 1, 8, 32, 128 };
+	const size_t shapeCount = sizeof(shapes) / sizeof(shapes[0]);
+	for (size_t i = 0; i < shapeCount; i++)
+		if (shapes[i] >= keys)
+			return shapes[i];
+	return shapes[shapeCount - 1];
+}
+
+static string InListSql(size_t shape)
+{
+	string list("(?");
+	for (size_t i = 1; i < shape; i++)
+		list += ",?";
+	return list + ")";
+}
+
+//" WHERE lo <= column <= hi" with the bounds appended to params ("" if unbounded)
+static string RangeWhere(const string & column, const RangeBound & lo, const RangeBound & hi, vector<FieldValue> & params)
+{
+	string zSql;
+	if (lo.bounded)
+	{
+		zSql += " WHERE " + column + (lo.inclusive ? " >= ?" : " > ?");
+		params.push_back(lo.value);
+	}
+	if (hi.bounded)
+	{
+		zSql += (lo.bounded ? " AND " : " WHERE ") + column + (hi.inclusive ? " <= ?" : " < ?");
+		params.push_back(hi.value);
+	}
+	return zSql;
+}
+
+static string IndexName(const string & tableName, const IndexDef & index)
+{
+	if (!index.name.empty())
+		return index.name;
+	string name = "IDX_" + tableName;
+	for (auto & column : index.columns)
+		name += "_" + column.name;
+	return name;
+}
+
+//Reads columns, sort orders, UNIQUE and the WHERE predicate back from the
+//CREATE INDEX statement SQLite keeps in sqlite_master
+static void ParseIndexSql(const string & zSql, IndexDef & index)
+{
+	string upper = TableKey(zSql);
+	index.unique = upper.compare(0, 20, "CREATE UNIQUE INDEX ") == 0;
+	size_t open = zSql.find('(');
+	size_t close = zSql.find(')', open);
+	if (open == string::npos || close == string::npos)
+		return;
+
+	size_t start = open + 1;
+	while (start < close)
+	{
+		size_t end = zSql.find(',', start);
+		if (end == string::npos || end > close)
+			end = close;
+		string term = zSql.substr(start, end - start);
+		term.erase(0, term.find_first_not_of(" \t\n"));
+		term.erase(term.find_last_not_of(" \t\n") + 1);
+		SortOrder order = Ascending;
+		string upperTerm = TableKey(term);
+		if (upperTerm.size() > 5 && upperTerm.compare(upperTerm.size() - 5, 5, " DESC") == 0)
+		{
+			order = Descending;
+			term.erase(term.size() - 5);
+		}
+		else if (upperTerm.size() > 4 && upperTerm.compare(upperTerm.size() - 4, 4, " ASC") == 0)
+			term.erase(term.size() - 4);
+		term.erase(term.find_last_not_of(" \t\n") + 1);
+		if (!term.empty())
+			index.columns.push_back(IndexColumn(term, order));
+		start = end + 1;
+	}
+
+	size_t where = upper.find(" WHERE ", close);
+	if (where != string::npos)
+		index.predicate = zSql.substr(where + 7);
+}
+
+//Column definition as used in CREATE TABLE / ALTER TABLE ADD
+static string ColumnSql(const ColumnDef & column)
+{
+	string zSql = column.name + " " + ColumnTypeName(column.type);
+	if (column.notNull)
+		zSql += " NOT NULL";
+	if (column.hasDefault)
+		zSql += " DEFAULT " + column.defaultValue.ToSqlLiteral();
+	return zSql;
+}
+
 //class implementation
 //Default Constructor
-EasyDB::EasyDB()
+EasyDB::EasyDB() : db(NULL), insertCacheHits(0), insertCacheMisses(0), advisorEnabled(false), advisorThreshold(0), rowCountsEnabled(false), rowCache(NULL)
 {
+	ResetBusyStats();
 }
 
 //Default Destructor
 EasyDB::~EasyDB()
 {
+	ClearInsertStatements();
+	ClearStatements();
 	if (this->db != NULL)
 	{
 		sqlite3_close_v2(db);
@@ -42,327 +164,2116 @@ int EasyDB::InitializeDatabase(const string & dbName)
 #endif
     string fp = std::string(path);
     fp = fp + "/"+dbName;
-	return sqlite3_open_v2(fp.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+	return OpenDatabase(fp, OpenOptions());
 }
 
 int EasyDB::InitializeDatabase(const string & dbName, const string & folderPath)
+{
+	return InitializeDatabase(dbName, folderPath, OpenOptions());
+}
+
+int EasyDB::InitializeDatabase(const string & dbName, const string & folderPath, const OpenOptions & options)
 {
 	string fp;
 	if (folderPath.empty())
 		fp = dbName;
 	else
 		fp = folderPath + "/" + dbName;
-    return sqlite3_open_v2(fp.c_str(),&db,SQLITE_OPEN_READWRITE |
-                           SQLITE_OPEN_CREATE,NULL);
+    return OpenDatabase(fp, options);
+}
+
+int EasyDB::OpenDatabase(const string & path, const OpenOptions & options)
+{
+	RefreshSchema();
+	int rc = sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+	if (SUCCESS(rc))
+		rc = SetBusyPolicy(busyPolicy);
+	if (SUCCESS(rc))
+		rc = ApplyOptions(options);
+	if (SUCCESS(rc))
+		InstallHooks();
+	return rc;
+}
+
+int EasyDB::ApplyOptions(const OpenOptions & options)
+{
+	//page_size has to come before journal_mode: a WAL database can't change it
+	string zSql;
+	if (options.pageSize > 0)
+		zSql += "PRAGMA page_size = " + std::to_string(options.pageSize) + ";";
+	if (!options.journalMode.empty())
+		zSql += "PRAGMA journal_mode = " + options.journalMode + ";";
+	if (!options.synchronous.empty())
+		zSql += "PRAGMA synchronous = " + options.synchronous + ";";
+	if (options.cacheSizeKiB > 0)
+		zSql += "PRAGMA cache_size = -" + std::to_string(options.cacheSizeKiB) + ";";
+	if (options.tempStore >= 0)
+		zSql += "PRAGMA temp_store = " + std::to_string(options.tempStore) + ";";
+	if (options.mmapSize >= 0)
+		zSql += "PRAGMA mmap_size = " + std::to_string(options.mmapSize) + ";";
+	if (zSql.empty())
+		return SQLITE_OK;
+	return sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
+}
+
+int EasyDB::SetProfile(OpenProfile profile)
+{
+	return ApplyOptions(OpenOptions::FromProfile(profile));
 }
 
 int EasyDB::GetRecords(const string & tableName, vector<vector<string>> & records)
 {
-    sqlite3_stmt *statement;
-    string query("SELECT * FROM "+tableName+";");
-	int rc = sqlite3_prepare_v2(db, VALUE(query), -1, &statement, 0);
+    Cursor cursor;
+	int rc = Scan(tableName, cursor);
     if(rc == SQLITE_OK)
     {
-        int cols = sqlite3_column_count(statement);
-        int result = 0;
-        while(true)
+        while((rc = cursor.Next()) == SQLITE_ROW)
         {
-            rc = sqlite3_step(statement);
-            if(rc == SQLITE_ROW)
-            {
-                vector<string> values;
-                for(int col = 0; col < cols; col++)
-                {
-					char * colText = (char*)sqlite3_column_text(statement, col);
-					if (colText != NULL)
-						values.push_back(colText);
-                }
-				records.push_back(values);
-            }
-            else
-            {
-                break;
-            }
+            vector<string> values;
+            cursor.GetRow(values);
+            records.push_back(std::move(values));
         }
-        sqlite3_finalize(statement);
     }
     return rc;
 }
 
-int EasyDB::GetRecord(const string & tableName, const string & whereClause, vector<string> & record)
+int EasyDB::GetRecords(const string & tableName, const vector<int64_t> & recordNumbers, vector<vector<string>> & rows, vector<bool> & found)
+{
+	rows.assign(recordNumbers.size(), vector<string>());
+	found.assign(recordNumbers.size(), false);
+
+	//where each RecordNumber goes in the result (duplicates allowed)
+	map<int64_t, vector<size_t>> positions;
+	for (size_t i = 0; i < recordNumbers.size(); i++)
+		positions[recordNumbers[i]].push_back(i);
+
+	int rc = SQLITE_DONE;
+	auto next = positions.begin();
+	size_t remaining = positions.size();
+	while (next != positions.end())
+	{
+		size_t shape = InListShape(remaining);
+		vector<FieldValue> params;
+		params.reserve(shape);
+		for (; next != positions.end() && params.size() < shape; ++next)
+			params.push_back(FieldValue((long long)next->first));
+		remaining -= params.size();
+		while (params.size() < shape)
+			params.push_back(params.back());
+
+		string zSql("SELECT * FROM " + tableName + " WHERE RecordNumber IN " + InListSql(shape) + ";");
+
+		Cursor cursor;
+		rc = OpenCursor(zSql, params, cursor);
+		if (rc != SQLITE_OK)
+			return rc;
+		while ((rc = cursor.Next()) == SQLITE_ROW)
+		{
+			auto match = positions.find(sqlite3_column_int64(cursor.stmt, 0));
+			if (match == positions.end())
+				continue;
+			const vector<size_t> & targets = match->second;
+			cursor.GetRow(rows[targets[0]]);
+			found[targets[0]] = true;
+			for (size_t i = 1; i < targets.size(); i++)
+			{
+				rows[targets[i]] = rows[targets[0]];
+				found[targets[i]] = true;
+			}
+		}
+		if (rc != SQLITE_DONE)
+			return rc;
+	}
+	return rc;
+}
+
+int EasyDB::GetTypedRecords(const string & tableName, vector<vector<FieldValue>> & records)
 {
-    sqlite3_stmt *statement;
-    string query("SELECT * FROM "+tableName+" WHERE "+whereClause);
-	int rc = sqlite3_prepare_v2(db, VALUE(query), -1, &statement, 0);
+    Cursor cursor;
+	int rc = Scan(tableName, cursor);
     if(rc == SQLITE_OK)
     {
-        int cols = sqlite3_column_count(statement);
-        int result = 0;
-        while(true)
+        while((rc = cursor.Next()) == SQLITE_ROW)
         {
-            rc = sqlite3_step(statement);
-            if(rc == SQLITE_ROW)
-            {
-                for(int col = 0; col < cols; col++)
-                {
-					char * colStr = (char*)sqlite3_column_text(statement, col);
-					if ( colStr != NULL)
-						record.push_back(colStr);
-                }
-            }
-            else
-            {
-                break;
-            }
+            vector<FieldValue> values;
+            cursor.GetTypedRow(values);
+            records.push_back(std::move(values));
         }
-        sqlite3_finalize(statement);
     }
-    string error = sqlite3_errmsg(db);
     return rc;
 }
 
-
-int EasyDB::GetRecord(const string & tableName, int rowIndex, vector<string> & record)
-{
-    auto vStr = std::to_string(rowIndex);
-    return this->GetRecord(tableName, "RecordNumber = "+vStr, record);
-}
-
-int EasyDB::DeleteRecords(const string & tableName)
+int EasyDB::GetPage(const string & tableName, long long afterRecordNumber, int limit, vector<vector<string>> & rows)
 {
-    int rc = 0;
-	string dSql("DELETE FROM " + tableName + ";");
-	rc = sqlite3_exec(db, VALUE(dSql), NULL, NULL, NULL);
+	vector<FieldValue> params;
+	params.push_back(FieldValue(afterRecordNumber));
+	params.push_back(FieldValue(limit));
+	Cursor cursor;
+	int rc = OpenCursor("SELECT * FROM " + tableName + " WHERE RecordNumber > ? ORDER BY RecordNumber LIMIT ?;", params, cursor);
+	if (rc == SQLITE_OK)
+	{
+		while ((rc = cursor.Next()) == SQLITE_ROW)
+		{
+			vector<string> values;
+			cursor.GetRow(values);
+			rows.push_back(std::move(values));
+		}
+	}
 	return rc;
 }
 
-int EasyDB::DeleteRecord(const string & tableName, const string & whereClause)
+int EasyDB::GetPage(const string & tableName, const string & orderColumn, const SortOrder & sortOrder, PageKey & after, int limit, vector<vector<string>> & rows)
 {
-    int rc = 0;
-	string dSql("DELETE FROM " + tableName + " WHERE "+whereClause+";");
-	rc = sqlite3_exec(db, VALUE(dSql), NULL, NULL, NULL);
-	return rc;
-}
+	TableSchema* schema = NULL;
+	int rc = GetTableSchema(tableName, schema);
+	if (!SUCCESS(rc))
+		return rc;
+	int orderIndex = -1;
+	for (size_t i = 0; i < schema->columnNames.size(); i++)
+		if (TableKey(schema->columnNames[i]) == TableKey(orderColumn))
+			orderIndex = (int)i;
+	if (orderIndex < 0)
+		return SQLITE_ERROR;
 
-int EasyDB::GetFieldNames(const string & tableName, vector<string> & fieldNames)
-{
-	int rc = 0;
-	sqlite3_stmt* stmt;
-	string zSql("pragma table_info('" + tableName + "');");
-	rc = sqlite3_prepare_v2(db, VALUE(zSql), -1, &stmt, 0);
-	if (SUCCESS(rc))
+	//3.8 has no row values, so (col, RecordNumber) > (?, ?) is spelled out; the
+	//leading col >= ? gives the planner a range to seek the index with
+	string direction = sortOrder == Descending ? " DESC" : "";
+	string compare = sortOrder == Descending ? " < " : " > ";
+	string zSql("SELECT * FROM " + tableName + " WHERE " + orderColumn + " IS NOT NULL");
+	vector<FieldValue> params;
+	if (after.started)
+	{
+		zSql += " AND " + orderColumn + (sortOrder == Descending ? " <= ?" : " >= ?");
+		zSql += " AND (" + orderColumn + compare + "? OR (" + orderColumn + " = ? AND RecordNumber" + compare + "?))";
+		params.push_back(after.value);
+		params.push_back(after.value);
+		params.push_back(after.value);
+		params.push_back(FieldValue(after.recordNumber));
+	}
+	zSql += " ORDER BY " + orderColumn + direction + ", RecordNumber" + direction + " LIMIT ?;";
+	params.push_back(FieldValue(limit));
+
+	Cursor cursor;
+	rc = OpenCursor(zSql, params, cursor);
+	if (rc == SQLITE_OK)
 	{
-		rc = TryStep(stmt, 100, 10);
-		while (rc == SQLITE_ROW)
+		while ((rc = cursor.Next()) == SQLITE_ROW)
 		{
-			const unsigned char* ptr = sqlite3_column_text(stmt, 1);
-			string tmp = (char*)ptr;
-			fieldNames.push_back(tmp);
-			rc = TryStep(stmt, 100, 10);
+			vector<string> values;
+			cursor.GetRow(values);
+			rows.push_back(std::move(values));
+			after.started = true;
+			after.value = FieldValue::FromColumn(cursor.stmt, orderIndex);
+			after.recordNumber = sqlite3_column_int64(cursor.stmt, 0);
 		}
 	}
-	sqlite3_finalize(stmt);
 	return rc;
 }
 
-int EasyDB::AddRecords(const string & tableName, vector<vector<string>> records)
+int EasyDB::ScanRange(const string & tableName, const string & column, const RangeBound & lo, const RangeBound & hi, const RowCallback & callback)
 {
-    int rc = 0;
-	for(auto rec:records)
-    {
-       rc = AddRecord(tableName, rec);
-    }
-    return rc;
+	return ScanRange(tableName, column, lo, hi, Ascending, callback);
 }
 
-//Initialize a new table (overwriting old one if exists)
-//Create table has default parameter of overwrite = true
-int EasyDB::CreateTable(const string & tableName, vector<string> & fieldList, const bool & overwrite)
+int EasyDB::ScanRange(const string & tableName, const string & column, const RangeBound & lo, const RangeBound & hi, const SortOrder & sortOrder, const RowCallback & callback)
 {
-    int rc = 0;
-    if(!overwrite)
-    {
-        bool exists = false;
-        rc = TableExists(tableName, exists);
-        if(SUCCESS(rc))
-        {
-            if(exists)
-                return SQLITE_OK;
-        }
-        else
-            return rc;
-    }
-    //uppercase tablename
-	string upperTableNanme(tableName);
-	transform(upperTableNanme.begin(), upperTableNanme.end(), upperTableNanme.begin(), toupper);
-	string dSql("DROP TABLE IF EXISTS " + upperTableNanme + ";");
-	string zSql("CREATE TABLE IF NOT EXISTS " + upperTableNanme + " (RecordNumber INTEGER NOT NULL PRIMARY KEY ");
-    for( auto rec : fieldList)
+	vector<FieldValue> params;
+	string zSql("SELECT * FROM " + tableName + RangeWhere(column, lo, hi, params));
+	string direction = sortOrder == Descending ? " DESC" : "";
+	zSql += " ORDER BY " + column + direction;
+	if (TableKey(column) != "RECORDNUMBER")
+		zSql += ", RecordNumber" + direction;
+
+	Cursor cursor;
+	int rc = OpenCursor(zSql, params, cursor);
+	if (rc != SQLITE_OK)
+		return rc;
+	RowView row = cursor.GetRowView();
+	while ((rc = cursor.Next()) == SQLITE_ROW)
 	{
-		zSql = zSql + ", " + rec + " TEXT ";
+		if (!callback(row))
+			break;
 	}
-	zSql = zSql + ");";
-	rc = sqlite3_exec(db, VALUE(dSql), NULL, NULL, NULL);
-	rc = sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
 	return rc;
 }
 
-int EasyDB::AddRecord(const string & tableName, vector<string> values)
+int EasyDB::Scan(const string & tableName, Cursor & cursor)
 {
-  	int rc = 0;
-	sqlite3_stmt* stmt;
-	unsigned long fieldCount = 0;
-	string zSql = this->GetInsertStatement(tableName, fieldCount);
-    rc = sqlite3_prepare_v2(db, VALUE(zSql), LENGTH(zSql), &stmt, 0);
-	if (SUCCESS(rc))
-	{
-		sqlite3_bind_text(stmt, 1, VALUE(tableName), LENGTH(tableName), SQLITE_TRANSIENT);
-		auto numValues = 0u;
-		if (values.size() <= fieldCount-1)
-			numValues = values.size();
-		else
-			numValues = fieldCount;
+    return OpenCursor("SELECT * FROM "+tableName+";", vector<FieldValue>(), cursor);
+}
 
-		for (auto i = 0u; i < numValues; i++)
-		{
-			string item = values[i];
-			if (item.size() == 0)
-				sqlite3_bind_null(stmt, i+1);
-			else
-				sqlite3_bind_text(stmt, i+1, VALUE(item), LENGTH(item), SQLITE_TRANSIENT);
-		}
+//Cursor implementation
+EasyDB::Cursor::Cursor() : stmt(NULL), owner(NULL)
+{
+}
 
-		for (unsigned int i = numValues; i < fieldCount; i++)
-		{
-			string item = ""; 
-			sqlite3_bind_text(stmt, i+1, VALUE(item), LENGTH(item), SQLITE_TRANSIENT);
-		}
+EasyDB::Cursor::~Cursor()
+{
+	Close();
+}
 
-		rc = this->TryStep(stmt, 100, 10);
-		rc = sqlite3_finalize(stmt);
-	}
-	return rc;
+EasyDB::Cursor::Cursor(Cursor && other) : stmt(other.stmt), owner(other.owner), sql(std::move(other.sql))
+{
+	other.stmt = NULL;
+	other.owner = NULL;
 }
 
-string EasyDB::GetInsertStatement(const string & tableName, unsigned long &fieldCount)
+EasyDB::Cursor & EasyDB::Cursor::operator=(Cursor && other)
 {
-	vector<string> fieldNames;
-	string tmp = "INSERT INTO " + tableName + " (";
-	string zSql(tmp.begin(), tmp.end());
-	this->GetFieldNames(tableName, fieldNames);
-	for(auto name:fieldNames)
-    {
-        if(name.compare("RecordNumber")==0) continue;
-        zSql.append(name + ", ");
-    }
-	zSql = zSql.substr(0, zSql.size() - 2);
-	zSql.append(") VALUES (");
-	zSql.append("?");
-	fieldCount = static_cast<unsigned char>(fieldNames.size());
-	if (fieldCount <= 2)
+	if (this != &other)
 	{
-		zSql.append(");");
-		return zSql;
+		Close();
+		stmt = other.stmt;
+		owner = other.owner;
+		sql = std::move(other.sql);
+		other.stmt = NULL;
+		other.owner = NULL;
 	}
-	for (unsigned int i = 3; i < fieldCount; i++)
+	return *this;
+}
+
+int EasyDB::Cursor::Next()
+{
+	if (stmt == NULL)
+		return SQLITE_MISUSE;
+	return sqlite3_step(stmt);
+}
+
+bool EasyDB::Cursor::IsOpen() const
+{
+	return stmt != NULL;
+}
+
+int EasyDB::Cursor::GetColumnCount() const
+{
+	return stmt != NULL ? sqlite3_column_count(stmt) : 0;
+}
+
+void EasyDB::Cursor::GetRow(vector<string> & row) const
+{
+	int cols = GetColumnCount();
+	for (int col = 0; col < cols; col++)
 	{
-		zSql.append(",?");
+		const char * colText = (const char*)sqlite3_column_text(stmt, col);
+		if (colText != NULL)
+			row.push_back(colText);
 	}
-	zSql.append(",?);");
-	return zSql;
 }
 
-int EasyDB::TryStep(sqlite3_stmt* &stmt, int t, int r)
+void EasyDB::Cursor::GetTypedRow(vector<FieldValue> & row) const
+{
+	int cols = GetColumnCount();
+	row.reserve(row.size() + cols);
+	for (int col = 0; col < cols; col++)
+		row.push_back(FieldValue::FromColumn(stmt, col));
+}
+
+RowView EasyDB::Cursor::GetRowView() const
 {
-	int rc = -1;
-	for (int retries = 0; retries < r; retries++)
+	return RowView(stmt);
+}
+
+void EasyDB::Cursor::Close()
+{
+	if (stmt != NULL)
 	{
-		rc = sqlite3_step(stmt);
-		if (rc != SQLITE_BUSY)
-			break;
-		std::this_thread::sleep_for (std::chrono::seconds(t));
+		if (owner != NULL)
+			owner->ReleaseStatement(sql, stmt);
+		else
+			sqlite3_finalize(stmt);
+		stmt = NULL;
+		owner = NULL;
 	}
-	return rc;
 }
 
-//Check if table exists
-int EasyDB::TableExists(const string & tableName, bool &exists)
+//RowView implementation
+int RowView::GetColumnCount() const
 {
-    exists = false;
-    int rc = 0;
-    //sql statement to check if table exist regardless of "case"
-    string zSql = "SELECT name FROM sqlite_master WHERE type='table' AND name='"+tableName+"' COLLATE NOCASE";
-    sqlite3_stmt *statement;
-    rc = sqlite3_prepare_v2(db, VALUE(zSql), -1, &statement, 0);
-    if(SUCCESS(rc))
-    {
-        int rc = sqlite3_step(statement);
-        if(rc == SQLITE_ROW)
-        {
-          exists = true;
-        }
-        sqlite3_finalize(statement);
-    }
-    return rc;
+	return sqlite3_column_count(stmt);
 }
 
+bool RowView::IsNull(int col) const
+{
+	return sqlite3_column_type(stmt, col) == SQLITE_NULL;
+}
 
-int EasyDB::AddIndex(const string & tableName, const string & columnName, const SortOrder & sortOrder)
+FieldView RowView::GetText(int col) const
 {
-    string zSql = "CREATE INDEX IDX_"+tableName+"_"+columnName+" on "+tableName+"("+columnName+");";
-    int rc = sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
-    return rc;
+	//text first, then bytes: the size must describe the converted value
+	const char* text = (const char*)sqlite3_column_text(stmt, col);
+	return FieldView(text, text != NULL ? sqlite3_column_bytes(stmt, col) : 0);
 }
 
-int EasyDB::RemoveIndex(const string & tableName, const string & columnName)
+FieldView RowView::GetBlob(int col) const
 {
-    string zSql = "DROP INDEX IDX_"+tableName+"_"+columnName+";";
-    int rc = sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
+	const char* blob = (const char*)sqlite3_column_blob(stmt, col);
+	return FieldView(blob, blob != NULL ? sqlite3_column_bytes(stmt, col) : 0);
+}
+
+sqlite3_int64 RowView::GetInt64(int col) const
+{
+	return sqlite3_column_int64(stmt, col);
+}
+
+double RowView::GetDouble(int col) const
+{
+	return sqlite3_column_double(stmt, col);
+}
+
+int EasyDB::GetRecord(const string & tableName, const string & whereClause, vector<string> & record)
+{
+    return this->GetRecord(tableName, whereClause, vector<FieldValue>(), record);
+}
+
+
+int EasyDB::GetRecord(const string & tableName, int rowIndex, vector<string> & record)
+{
+    if (rowCache == NULL || !rowCache->IsActive())
+        return this->GetRecord(tableName, "RecordNumber = ?", vector<FieldValue>(1, FieldValue(rowIndex)), record);
+
+    string key = TableKey(tableName);
+    unsigned long long version = 0;
+    if (rowCache->Lookup(key, rowIndex, record, version))
+        return SQLITE_DONE;
+    size_t first = record.size();
+    int rc = this->GetRecord(tableName, "RecordNumber = ?", vector<FieldValue>(1, FieldValue(rowIndex)), record);
+    if (rc == SQLITE_DONE && record.size() > first && writtenTables.count(key) == 0)
+        rowCache->Store(key, rowIndex, version, record.begin() + first, record.end());
     return rc;
 }
 
-int EasyDB::AddColumn(const string & tableName, const string & columnName)
+int EasyDB::GetRecord(const string & tableName, const string & predicate, const vector<FieldValue> & params, vector<string> & record)
 {
-	bool exists = false;
-	int rc = TableExists(tableName, exists);
-	if (SUCCESS(rc))
-	{
-		if (!exists)
-			return rc;
+    return GetRecord(tableName, vector<string>(), predicate, params, record);
+}
 
-		string zSql("ALTER TABLE " + tableName + " ADD " + columnName + " TEXT");
-		rc = sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
-	}
-	return rc;
+int EasyDB::GetRecord(const string & tableName, const Where & where, vector<string> & record)
+{
+    return GetRecord(tableName, where.GetPredicate(), where.GetParams(), record);
 }
 
-unsigned int EasyDB::GetNumColumns(const string & tableName)
+int EasyDB::GetRecord(const string & tableName, const vector<string> & columns, const string & predicate, const vector<FieldValue> & params, vector<string> & record)
 {
-	int cols = 0;
-	sqlite3_stmt *statement;
-	string query("SELECT * FROM " + tableName + ";");
-	if (sqlite3_prepare_v2(db, VALUE(query), -1, &statement, 0) == SQLITE_OK)
-		cols = sqlite3_column_count(statement);
-	return cols;
+    string zSql(columns.empty() ? "SELECT *" : "SELECT ");
+    for (size_t i = 0; i < columns.size(); i++)
+        zSql += (i == 0 ? "" : ", ") + columns[i];
+    string cacheKey;
+    if (queryCache.GetBudget() > 0)
+    {
+        cacheKey = QueryKey(tableName, zSql, predicate, params);
+        if (queryCache.Lookup(cacheKey, record))
+            return SQLITE_DONE;
+    }
+    auto start = advisorEnabled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    size_t first = record.size();
+    Cursor cursor;
+    int rc = OpenCursor(zSql + " FROM " + tableName + " WHERE " + predicate, params, cursor);
+    if(rc == SQLITE_OK)
+    {
+        while((rc = cursor.Next()) == SQLITE_ROW)
+            cursor.GetRow(record);
+    }
+    cursor.Close();
+    if (!cacheKey.empty() && rc == SQLITE_DONE && writtenTables.count(TableKey(tableName)) == 0)
+        queryCache.Store(TableKey(tableName), cacheKey, record.begin() + first, record.end());
+    if (advisorEnabled && rc == SQLITE_DONE)
+        ObservePredicate(tableName, predicate, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    return rc;
 }
 
-unsigned int EasyDB::GetNumRows(const string & tableName)
+int EasyDB::DeleteRecords(const string & tableName)
 {
-	int rows = 0;
-	sqlite3_stmt *statement;
-	string query("SELECT COUNT(*) FROM " + tableName + ";");
-	if (sqlite3_prepare_v2(db, VALUE(query), -1, &statement, 0) == SQLITE_OK)
+	int rc = ExecuteCached("DELETE FROM " + tableName + ";", vector<FieldValue>());
+	//the truncate optimization deletes without calling the update hook
+	if (rc == SQLITE_OK)
 	{
-		while (sqlite3_step(statement) == SQLITE_ROW)
+		string key = TableKey(tableName);
+		queryCache.Invalidate(key);
+		InvalidateCachedRow(key, -1);
+		if (CachingRows() && sqlite3_get_autocommit(db) == 0)
+			writtenTables.insert(key);
+	}
+	if (rowCountsEnabled && rc == SQLITE_OK)
+	{
+		string key = TableKey(tableName);
+		if (sqlite3_get_autocommit(db) != 0)
+		{
+			rowCounts[key] = 0;
+			pendingRowCounts.erase(key);
+		}
+		else
 		{
-			rows = sqlite3_column_int(statement, 0);
+			pendingRowCounts[key].truncated = true;
+			pendingRowCounts[key].delta = 0;
 		}
 	}
-	return rows;
+	return rc;
 }
 
-int EasyDB::DeleteTable(const string & tableName)
+int EasyDB::DeleteRecord(const string & tableName, const string & whereClause)
+{
+	return DeleteRecord(tableName, whereClause, vector<FieldValue>());
+}
+
+int EasyDB::DeleteRecord(const string & tableName, const string & predicate, const vector<FieldValue> & params)
+{
+	auto start = advisorEnabled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+	int rc = ExecuteCached("DELETE FROM " + tableName + " WHERE " + predicate + ";", params);
+	if (advisorEnabled && rc == SQLITE_OK)
+		ObservePredicate(tableName, predicate, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+	return rc;
+}
+
+int EasyDB::DeleteRecord(const string & tableName, const Where & where)
+{
+	return DeleteRecord(tableName, where.GetPredicate(), where.GetParams());
+}
+
+int EasyDB::DeleteRecords(const string & tableName, const vector<int64_t> & recordNumbers, unsigned int maxRowsPerTxn)
+{
+	BatchStats stats;
+	return DeleteRecords(tableName, recordNumbers, maxRowsPerTxn, stats);
+}
+
+int EasyDB::DeleteRecords(const string & tableName, const vector<int64_t> & recordNumbers, unsigned int maxRowsPerTxn, BatchStats & stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats.rows = 0;
+	stats.elapsedSeconds = 0;
+	stats.rowsPerSecond = 0;
+	if (maxRowsPerTxn == 0)
+		maxRowsPerTxn = 1;
+
+	vector<int64_t> keys(recordNumbers);
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+	//inside the caller's transaction there is nothing to chunk
+	bool ownTransactions = sqlite3_get_autocommit(db) != 0;
+	int rc = SQLITE_OK;
+	size_t next = 0;
+	while (next < keys.size())
+	{
+		size_t chunkEnd = (std::min)(keys.size(), next + maxRowsPerTxn);
+		if (ownTransactions)
+		{
+			rc = BeginTransaction();
+			if (!SUCCESS(rc))
+				break;
+		}
+
+		unsigned long deleted = 0;
+		while (next < chunkEnd && SUCCESS(rc))
+		{
+			size_t shape = InListShape(chunkEnd - next);
+			vector<FieldValue> params;
+			params.reserve(shape);
+			for (; next < chunkEnd && params.size() < shape; next++)
+				params.push_back(FieldValue((long long)keys[next]));
+			while (params.size() < shape)
+				params.push_back(params.back());
+			rc = ExecuteCached("DELETE FROM " + tableName + " WHERE RecordNumber IN " + InListSql(shape) + ";", params);
+			if (SUCCESS(rc))
+				deleted += sqlite3_changes(db);
+		}
+
+		if (ownTransactions)
+		{
+			if (SUCCESS(rc))
+				rc = CommitTransaction();
+			if (!SUCCESS(rc))
+				RollbackTransaction();
+		}
+		if (!SUCCESS(rc))
+			break;
+		stats.rows += deleted;
+	}
+
+	stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (stats.elapsedSeconds > 0)
+		stats.rowsPerSecond = stats.rows / stats.elapsedSeconds;
+	return rc;
+}
+
+int EasyDB::DeleteRange(const string & tableName, const string & column, const RangeBound & lo, const RangeBound & hi, unsigned int maxRowsPerTxn)
+{
+	BatchStats stats;
+	return DeleteRange(tableName, column, lo, hi, maxRowsPerTxn, stats);
+}
+
+int EasyDB::DeleteRange(const string & tableName, const string & column, const RangeBound & lo, const RangeBound & hi, unsigned int maxRowsPerTxn, BatchStats & stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats.rows = 0;
+	stats.elapsedSeconds = 0;
+	stats.rowsPerSecond = 0;
+	if (maxRowsPerTxn == 0)
+		maxRowsPerTxn = 1;
+
+	//DELETE ... LIMIT needs a compile-time option, so the chunk is picked by a subquery
+	vector<FieldValue> params;
+	string zSql("DELETE FROM " + tableName + " WHERE RecordNumber IN (SELECT RecordNumber FROM " + tableName +
+		RangeWhere(column, lo, hi, params) + " LIMIT ?);");
+	params.push_back(FieldValue((long long)maxRowsPerTxn));
+
+	bool ownTransactions = sqlite3_get_autocommit(db) != 0;
+	int rc = SQLITE_OK;
+	while (true)
+	{
+		if (ownTransactions)
+		{
+			rc = BeginTransaction();
+			if (!SUCCESS(rc))
+				break;
+		}
+		rc = ExecuteCached(zSql, params);
+		unsigned long deleted = SUCCESS(rc) ? (unsigned long)sqlite3_changes(db) : 0;
+		if (ownTransactions)
+		{
+			if (SUCCESS(rc))
+				rc = CommitTransaction();
+			if (!SUCCESS(rc))
+				RollbackTransaction();
+		}
+		if (!SUCCESS(rc))
+			break;
+		stats.rows += deleted;
+		if (deleted < maxRowsPerTxn)
+			break;
+	}
+
+	stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (stats.elapsedSeconds > 0)
+		stats.rowsPerSecond = stats.rows / stats.elapsedSeconds;
+	return rc;
+}
+
+int EasyDB::AcquireStatement(const string & zSql, sqlite3_stmt* &stmt)
+{
+	return statementCache.Acquire(db, zSql, stmt);
+}
+
+void EasyDB::ReleaseStatement(const string & zSql, sqlite3_stmt* stmt)
+{
+	statementCache.Release(zSql, stmt);
+}
+
+void EasyDB::ClearStatements()
+{
+	statementCache.Clear();
+}
+
+void EasyDB::SetStatementCacheCapacity(size_t capacity)
+{
+	statementCache.SetCapacity(capacity);
+}
+
+void EasyDB::GetStatementCacheStats(StatementCacheStats & stats) const
+{
+	statementCache.GetStats(stats);
+}
+
+int EasyDB::OpenCursor(const string & zSql, const vector<FieldValue> & params, Cursor & cursor)
+{
+	cursor.Close();
+	sqlite3_stmt* stmt = NULL;
+	int rc = AcquireStatement(zSql, stmt);
+	if (rc != SQLITE_OK)
+		return rc;
+	for (size_t i = 0; i < params.size() && rc == SQLITE_OK; i++)
+		rc = params[i].Bind(stmt, (int)i + 1);
+	cursor.stmt = stmt;
+	cursor.owner = this;
+	cursor.sql = zSql;
+	if (rc != SQLITE_OK)
+		cursor.Close();
+	return rc;
+}
+
+//Runs a statement that returns no rows (DELETE/UPDATE/...) from the cache
+int EasyDB::ExecuteCached(const string & zSql, const vector<FieldValue> & params)
+{
+	Cursor cursor;
+	int rc = OpenCursor(zSql, params, cursor);
+	if (rc != SQLITE_OK)
+		return rc;
+	//a failing statement is rolled back without any hook, so its row-count
+	//changes are undone here (unless the whole transaction went with it)
+	map<string, RowCountDelta> pendingBefore;
+	if (rowCountsEnabled)
+		pendingBefore = pendingRowCounts;
+	while ((rc = cursor.Next()) == SQLITE_ROW)
+		;
+	if (rowCountsEnabled && rc != SQLITE_DONE)
+	{
+		if (sqlite3_get_autocommit(db) == 0)
+			pendingRowCounts.swap(pendingBefore);
+		else
+			pendingRowCounts.clear();
+	}
+	if (rc != SQLITE_DONE && sqlite3_get_autocommit(db) != 0)
+		writtenTables.clear();
+	return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
+
+int EasyDB::GetFieldNames(const string & tableName, vector<string> & fieldNames)
+{
+	TableSchema* schema = NULL;
+	int rc = GetTableSchema(tableName, schema);
+	if (!SUCCESS(rc))
+		return rc;
+	fieldNames.insert(fieldNames.end(), schema->columnNames.begin(), schema->columnNames.end());
+	//same result code as stepping pragma table_info to the end
+	return SQLITE_DONE;
+}
+
+//Returns the catalog entry for the table, loading it on first use.
+//Missing tables are cached too (exists == false).
+int EasyDB::GetTableSchema(const string & tableName, TableSchema* &schema, bool recheckMissing)
+{
+	string key = TableKey(tableName);
+	auto it = schemaCatalog.find(key);
+	if (it != schemaCatalog.end() && !(recheckMissing && !it->second.exists))
+	{
+		schema = &it->second;
+		return SQLITE_OK;
+	}
+
+	TableSchema loaded;
+	int rc = LoadTableSchema(tableName, loaded);
+	if (SUCCESS(rc))
+		schema = &(schemaCatalog[key] = loaded);
+	return rc;
+}
+
+int EasyDB::LoadTableSchema(const string & tableName, TableSchema & schema)
+{
+	schema.exists = false;
+	schema.columnNames.clear();
+	schema.columnTypes.clear();
+	schema.indexes.clear();
+
+	sqlite3_stmt* stmt = NULL;
+	string zSql("pragma table_info('" + tableName + "');");
+	int rc = AcquireStatement(zSql, stmt);
+	if (SUCCESS(rc))
+	{
+		while ((rc = TryStep(stmt)) == SQLITE_ROW)
+		{
+			const char* name = (const char*)sqlite3_column_text(stmt, 1);
+			const char* type = (const char*)sqlite3_column_text(stmt, 2);
+			schema.columnNames.push_back(name != NULL ? name : "");
+			schema.columnTypes.push_back(type != NULL ? type : "");
+		}
+		ReleaseStatement(zSql, stmt);
+	}
+	if (rc != SQLITE_DONE)
+		return rc;
+	schema.exists = !schema.columnNames.empty();
+	if (!schema.exists)
+		return SQLITE_OK;
+
+	vector<FieldValue> params(1, FieldValue(tableName));
+	Cursor cursor;
+	rc = OpenCursor("SELECT name, sql FROM sqlite_master WHERE type = 'index' AND tbl_name = ? COLLATE NOCASE;", params, cursor);
+	if (SUCCESS(rc))
+	{
+		while ((rc = cursor.Next()) == SQLITE_ROW)
+		{
+			RowView row = cursor.GetRowView();
+			IndexDef index(row.GetText(0).ToString());
+			if (row.IsNull(1))
+				index.unique = true;	//sqlite_autoindex_* behind a UNIQUE constraint
+			else
+				ParseIndexSql(row.GetText(1).ToString(), index);
+			schema.indexes.push_back(index);
+		}
+	}
+	return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
+
+void EasyDB::InvalidateTableSchema(const string & tableName)
+{
+	schemaCatalog.erase(TableKey(tableName));
+}
+
+void EasyDB::RefreshSchema()
+{
+	ClearInsertStatements();
+	ClearStatements();
+	schemaCatalog.clear();
+	queryCache.Clear();
+	if (ownedRowCache)
+		ownedRowCache->Clear();
+}
+
+int EasyDB::AddRecords(const string & tableName, const vector<vector<string>> & records)
+{
+	BatchStats stats;
+	return AddRecords(tableName, records, stats);
+}
+
+int EasyDB::AddRecords(const string & tableName, const vector<vector<string>> & records, BatchStats & stats)
+{
+	auto start = std::chrono::steady_clock::now();
+	stats.rows = 0;
+	stats.elapsedSeconds = 0;
+	stats.rowsPerSecond = 0;
+
+	InsertStatement* insert = NULL;
+	int rc = this->GetCachedInsert(tableName, insert);
+	if (!SUCCESS(rc))
+		return rc;
+
+	//only own the transaction when the caller hasn't opened one
+	bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+	if (ownTransaction)
+	{
+		rc = BeginTransaction();
+		if (!SUCCESS(rc))
+			return rc;
+	}
+
+	for (auto & rec : records)
+	{
+		rc = InsertRow(insert, rec);
+		if (!SUCCESS(rc))
+			break;
+		stats.rows++;
+	}
+
+	if (ownTransaction)
+	{
+		if (SUCCESS(rc))
+			rc = CommitTransaction();
+		if (!SUCCESS(rc))
+		{
+			RollbackTransaction();
+			stats.rows = 0;
+		}
+	}
+
+	stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (stats.elapsedSeconds > 0)
+		stats.rowsPerSecond = stats.rows / stats.elapsedSeconds;
+	return rc;
+}
+
+int EasyDB::AddTypedRecord(const string & tableName, const vector<FieldValue> & values)
+{
+	InsertStatement* insert = NULL;
+	int rc = this->GetCachedInsert(tableName, insert);
+	if (SUCCESS(rc))
+		rc = InsertTypedRow(insert, values);
+	return rc;
+}
+
+int EasyDB::AddTypedRecords(const string & tableName, const vector<vector<FieldValue>> & records)
+{
+	InsertStatement* insert = NULL;
+	int rc = this->GetCachedInsert(tableName, insert);
+	if (!SUCCESS(rc))
+		return rc;
+
+	bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+	if (ownTransaction)
+	{
+		rc = BeginTransaction();
+		if (!SUCCESS(rc))
+			return rc;
+	}
+
+	for (auto & rec : records)
+	{
+		rc = InsertTypedRow(insert, rec);
+		if (!SUCCESS(rc))
+			break;
+	}
+
+	if (ownTransaction)
+	{
+		if (SUCCESS(rc))
+			rc = CommitTransaction();
+		if (!SUCCESS(rc))
+			RollbackTransaction();
+	}
+	return rc;
+}
+
+int EasyDB::UpdateRecord(const string & tableName, const vector<string> & columns, const vector<FieldValue> & values, const string & predicate, const vector<FieldValue> & params)
+{
+	if (columns.empty() || columns.size() != values.size())
+		return SQLITE_MISUSE;
+	string zSql("UPDATE " + tableName + " SET ");
+	for (size_t i = 0; i < columns.size(); i++)
+		zSql += (i == 0 ? "" : ", ") + columns[i] + " = ?";
+	zSql += " WHERE " + predicate + ";";
+
+	vector<FieldValue> bound(values);
+	bound.insert(bound.end(), params.begin(), params.end());
+	int rc = ExecuteCached(zSql, bound);
+	//the update hook only reports the new RecordNumber of a moved row
+	for (auto & column : columns)
+	{
+		if (TableKey(column) == "RECORDNUMBER")
+			InvalidateCachedRow(TableKey(tableName), -1);
+	}
+	return rc;
+}
+
+int EasyDB::UpdateRecord(const string & tableName, const vector<string> & columns, const vector<FieldValue> & values, const Where & where)
+{
+	return UpdateRecord(tableName, columns, values, where.GetPredicate(), where.GetParams());
+}
+
+//SQLite 3.8 has no INSERT ... ON CONFLICT DO UPDATE, so each row is an UPDATE
+//on its keys followed by an INSERT when nothing matched. Both statements are
+//cached and the write transaction keeps the pair atomic.
+int EasyDB::UpsertRecords(const string & tableName, const vector<string> & keyColumns, const vector<vector<FieldValue>> & rows)
+{
+	TableSchema* schema = NULL;
+	int rc = GetTableSchema(tableName, schema, true);
+	if (!SUCCESS(rc))
+		return rc;
+	if (!schema->exists || keyColumns.empty())
+		return SQLITE_MISUSE;
+
+	//row values are in table order without RecordNumber
+	vector<string> columns(schema->columnNames.begin() + 1, schema->columnNames.end());
+	vector<size_t> keys;
+	vector<size_t> updates;
+	for (auto & key : keyColumns)
+	{
+		size_t i = 0;
+		while (i < columns.size() && TableKey(columns[i]) != TableKey(key))
+			i++;
+		if (i == columns.size())
+			return SQLITE_MISUSE;
+		keys.push_back(i);
+	}
+	for (size_t i = 0; i < columns.size(); i++)
+		if (std::find(keys.begin(), keys.end(), i) == keys.end())
+			updates.push_back(i);
+
+	string zSql("UPDATE " + tableName + " SET ");
+	if (updates.empty())
+		zSql += columns[keys[0]] + " = " + columns[keys[0]];	//only counts the match
+	for (size_t i = 0; i < updates.size(); i++)
+		zSql += (i == 0 ? "" : ", ") + columns[updates[i]] + " = ?";
+	for (size_t i = 0; i < keys.size(); i++)
+		zSql += (i == 0 ? " WHERE " : " AND ") + columns[keys[i]] + " = ?";
+	zSql += ";";
+
+	InsertStatement* insert = NULL;
+	rc = GetCachedInsert(tableName, insert);
+	if (!SUCCESS(rc))
+		return rc;
+
+	bool ownTransaction = sqlite3_get_autocommit(db) != 0;
+	if (ownTransaction)
+	{
+		rc = BeginTransaction();
+		if (!SUCCESS(rc))
+			return rc;
+	}
+
+	vector<FieldValue> params;
+	for (auto & row : rows)
+	{
+		if (row.size() != columns.size())
+		{
+			rc = SQLITE_RANGE;
+			break;
+		}
+		params.clear();
+		for (auto i : updates)
+			params.push_back(row[i]);
+		for (auto i : keys)
+			params.push_back(row[i]);
+		rc = ExecuteCached(zSql, params);
+		if (rc == SQLITE_OK && sqlite3_changes(db) == 0)
+			rc = InsertTypedRow(insert, row);
+		if (!SUCCESS(rc))
+			break;
+	}
+
+	if (ownTransaction)
+	{
+		if (SUCCESS(rc))
+			rc = CommitTransaction();
+		if (!SUCCESS(rc))
+			RollbackTransaction();
+	}
+	return rc;
+}
+
+int EasyDB::BeginTransaction()
+{
+	return sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+}
+
+int EasyDB::CommitTransaction()
+{
+	return sqlite3_exec(db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+}
+
+int EasyDB::RollbackTransaction()
+{
+	return sqlite3_exec(db, "ROLLBACK TRANSACTION;", NULL, NULL, NULL);
+}
+
+int EasyDB::RunGroup(const vector<Operation> & ops, vector<int> & results)
+{
+	results.assign(ops.size(), SQLITE_OK);
+	if (ops.empty())
+		return SQLITE_OK;
+
+	int rc = BeginTransaction();
+	if (!SUCCESS(rc))
+	{
+		results.assign(ops.size(), rc);
+		return rc;
+	}
+
+	//a lone op needs no savepoint: on failure the whole transaction is its own
+	if (ops.size() == 1)
+	{
+		results[0] = ops[0](*this);
+		if (!SUCCESS(results[0]) && results[0] != SQLITE_DONE)
+		{
+			RollbackTransaction();
+			return SQLITE_OK;
+		}
+	}
+
+	for (size_t i = 0; i < ops.size() && ops.size() > 1; i++)
+	{
+		rc = ExecuteCached("SAVEPOINT EasyDBGroupOp;", vector<FieldValue>());
+		if (!SUCCESS(rc))
+		{
+			results[i] = rc;
+			continue;
+		}
+		map<string, RowCountDelta> pendingBefore;
+		if (rowCountsEnabled)
+			pendingBefore = pendingRowCounts;
+		results[i] = ops[i](*this);
+		if (!SUCCESS(results[i]) && results[i] != SQLITE_DONE)
+		{
+			//ROLLBACK TO fires no hook
+			ExecuteCached("ROLLBACK TO EasyDBGroupOp;", vector<FieldValue>());
+			if (rowCountsEnabled)
+				pendingRowCounts.swap(pendingBefore);
+		}
+		ExecuteCached("RELEASE EasyDBGroupOp;", vector<FieldValue>());
+	}
+
+	rc = CommitTransaction();
+	if (!SUCCESS(rc))
+	{
+		RollbackTransaction();
+		results.assign(ops.size(), rc);
+	}
+	return rc;
+}
+
+//Initialize a new table (overwriting old one if exists)
+//Create table has default parameter of overwrite = true
+int EasyDB::CreateTable(const string & tableName, vector<string> & fieldList, const bool & overwrite)
+{
+	vector<ColumnDef> columns;
+	for (auto & field : fieldList)
+		columns.push_back(ColumnDef(field));
+	return CreateTable(tableName, columns, overwrite);
+}
+
+int EasyDB::CreateTable(const string & tableName, const vector<ColumnDef> & columns, const bool & overwrite)
+{
+    int rc = 0;
+    if(!overwrite)
+    {
+        bool exists = false;
+        rc = TableExists(tableName, exists);
+        if(SUCCESS(rc))
+        {
+            if(exists)
+                return SQLITE_OK;
+        }
+        else
+            return rc;
+    }
+    //uppercase tablename
+	string upperTableNanme(tableName);
+	transform(upperTableNanme.begin(), upperTableNanme.end(), upperTableNanme.begin(), ::toupper);
+	InvalidateInsertStatement(tableName);
+	InvalidateCachedRows(tableName);
+	string dSql("DROP TABLE IF EXISTS " + upperTableNanme + ";");
+	string zSql("CREATE TABLE IF NOT EXISTS " + upperTableNanme + " (RecordNumber INTEGER NOT NULL PRIMARY KEY ");
+    for(auto & column : columns)
+	{
+		zSql = zSql + ", " + ColumnSql(column) + " ";
+	}
+	zSql = zSql + ");";
+	rc = sqlite3_exec(db, VALUE(dSql), NULL, NULL, NULL);
+	rc = sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
+	if (SUCCESS(rc))
+	{
+		TableSchema & schema = schemaCatalog[TableKey(tableName)];
+		schema.exists = true;
+		schema.columnNames.assign(1, "RecordNumber");
+		schema.columnTypes.assign(1, "INTEGER");
+		schema.indexes.clear();
+		for (auto & column : columns)
+		{
+			schema.columnNames.push_back(column.name);
+			schema.columnTypes.push_back(ColumnTypeName(column.type));
+		}
+	}
+	else
+		InvalidateTableSchema(tableName);
+	return rc;
+}
+
+int EasyDB::AddRecord(const string & tableName, const vector<string> & values)
+{
+	InsertStatement* insert = NULL;
+	int rc = this->GetCachedInsert(tableName, insert);
+	if (SUCCESS(rc))
+		rc = InsertRow(insert, values);
+	return rc;
+}
+
+//Binds one row to the cached INSERT, steps it and resets it for the next row.
+int EasyDB::InsertRow(InsertStatement* insert, const vector<string> & values)
+{
+	sqlite3_stmt* stmt = insert->stmt;
+	unsigned int numParams = sqlite3_bind_parameter_count(stmt);
+	unsigned int numValues = values.size() < numParams ? (unsigned int)values.size() : numParams;
+
+	for (auto i = 0u; i < numValues; i++)
+	{
+		const string & item = values[i];
+		if (item.size() == 0)
+			sqlite3_bind_null(stmt, i+1);
+		else
+			sqlite3_bind_text(stmt, i+1, VALUE(item), LENGTH(item), SQLITE_STATIC);
+	}
+
+	for (unsigned int i = numValues; i < numParams; i++)
+	{
+		sqlite3_bind_text(stmt, i+1, "", 0, SQLITE_STATIC);
+	}
+
+	int rc = this->TryStep(stmt);
+	//reset reports the step error (if any) and readies the statement for the next row
+	rc = sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	return rc;
+}
+
+//Typed variant of InsertRow, missing trailing values are inserted as NULL
+int EasyDB::InsertTypedRow(InsertStatement* insert, const vector<FieldValue> & values)
+{
+	sqlite3_stmt* stmt = insert->stmt;
+	unsigned int numParams = sqlite3_bind_parameter_count(stmt);
+	unsigned int numValues = values.size() < numParams ? (unsigned int)values.size() : numParams;
+
+	for (auto i = 0u; i < numValues; i++)
+		values[i].Bind(stmt, i+1);
+
+	int rc = this->TryStep(stmt);
+	rc = sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	return rc;
+}
+
+//Returns the compiled INSERT for the table, preparing and caching it on first use.
+int EasyDB::GetCachedInsert(const string & tableName, InsertStatement* &insert)
+{
+	string key = TableKey(tableName);
+	auto it = insertStatements.find(key);
+	if (it != insertStatements.end())
+	{
+		insertCacheHits++;
+		insert = &it->second;
+		return SQLITE_OK;
+	}
+
+	insertCacheMisses++;
+	InsertStatement entry;
+	string zSql;
+	int rc = this->GetInsertStatement(tableName, zSql);
+	if (!SUCCESS(rc))
+		return rc;
+	rc = sqlite3_prepare_v2(db, VALUE(zSql), LENGTH(zSql), &entry.stmt, 0);
+	if (SUCCESS(rc))
+		insert = &(insertStatements[key] = entry);
+	else
+		sqlite3_finalize(entry.stmt);
+	return rc;
+}
+
+//Must be called before any change to the table's columns - the cached
+//statement (and its column list) would otherwise describe the old layout.
+void EasyDB::InvalidateInsertStatement(const string & tableName)
+{
+	auto it = insertStatements.find(TableKey(tableName));
+	if (it != insertStatements.end())
+	{
+		sqlite3_finalize(it->second.stmt);
+		insertStatements.erase(it);
+	}
+}
+
+void EasyDB::ClearInsertStatements()
+{
+	for (auto & entry : insertStatements)
+		sqlite3_finalize(entry.second.stmt);
+	insertStatements.clear();
+}
+
+void EasyDB::GetInsertCacheStats(unsigned long & hits, unsigned long & misses) const
+{
+	hits = insertCacheHits;
+	misses = insertCacheMisses;
+}
+
+//Fails with SQLITE_ERROR when the table doesn't exist or has no column
+//besides RecordNumber, rather than building an INSERT that drops the values.
+int EasyDB::GetInsertStatement(const string & tableName, string & zSql)
+{
+	TableSchema* schema = NULL;
+	int rc = GetTableSchema(tableName, schema, true);
+	if (!SUCCESS(rc))
+		return rc;
+
+	string names;
+	string params;
+	for (auto & name : schema->columnNames)
+	{
+		if (name.compare("RecordNumber") == 0) continue;
+		names.append(names.empty() ? name : ", " + name);
+		params.append(params.empty() ? "?" : ",?");
+	}
+	if (names.empty())
+		return SQLITE_ERROR;
+	zSql = "INSERT INTO " + tableName + " (" + names + ") VALUES (" + params + ");";
+	return SQLITE_OK;
+}
+
+//Lock waits happen inside sqlite3_step through BusyHandler, so SQLITE_BUSY
+//here means the policy's deadline passed (or SQLite refused to wait to avoid
+//a deadlock) and retrying would not help.
+int EasyDB::TryStep(sqlite3_stmt* &stmt)
+{
+	return sqlite3_step(stmt);
+}
+
+int EasyDB::SetBusyPolicy(const BusyPolicy & policy)
+{
+	busyPolicy = policy;
+	if (db == NULL)
+		return SQLITE_OK;
+	return sqlite3_busy_handler(db, &EasyDB::BusyHandler, this);
+}
+
+void EasyDB::GetBusyStats(BusyStats & stats) const
+{
+	stats = busyStats;
+}
+
+void EasyDB::ResetBusyStats()
+{
+	busyStats.busyEvents = 0;
+	busyStats.busyRetries = 0;
+	busyStats.busyTimeouts = 0;
+	busyStats.waitMicros = 0;
+}
+
+//sqlite3_busy_handler callback: count is 0 on the first call of a busy event.
+//Returning 0 makes the blocked call fail with SQLITE_BUSY.
+int EasyDB::BusyHandler(void* easyDB, int count)
+{
+	EasyDB* self = (EasyDB*)easyDB;
+	const BusyPolicy & policy = self->busyPolicy;
+	auto now = std::chrono::steady_clock::now();
+	if (count == 0)
+	{
+		self->busyStats.busyEvents++;
+		self->busyStart = now;
+	}
+
+	long long elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - self->busyStart).count();
+	long long remaining = (long long)policy.timeoutMillis * 1000 - elapsed;
+	if (remaining <= 0)
+	{
+		self->busyStats.busyTimeouts++;
+		return 0;
+	}
+
+	double delay = policy.initialBackoffMicros * pow(policy.backoffMultiplier, count);
+	if (delay > policy.maxBackoffMicros)
+		delay = policy.maxBackoffMicros;
+	if (policy.jitter > 0)
+	{
+		std::uniform_real_distribution<double> spread(1.0 - policy.jitter, 1.0);
+		delay *= spread(self->busyRandom);
+	}
+	long long sleepMicros = (long long)delay;
+	if (sleepMicros > remaining)
+		sleepMicros = remaining;
+	if (sleepMicros < 1)
+		sleepMicros = 1;
+
+	std::this_thread::sleep_for(std::chrono::microseconds(sleepMicros));
+	self->busyStats.busyRetries++;
+	self->busyStats.waitMicros += std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - now).count();
+	return 1;
+}
+
+//Check if table exists (views don't count, table names are not case sensitive)
+int EasyDB::TableExists(const string & tableName, bool &exists)
+{
+    exists = false;
+    vector<FieldValue> params(1, FieldValue(tableName));
+    Cursor cursor;
+    int rc = OpenCursor("SELECT name FROM sqlite_master WHERE type='table' AND name = ? COLLATE NOCASE;", params, cursor);
+    if(SUCCESS(rc))
+    {
+        rc = cursor.Next();
+        exists = rc == SQLITE_ROW;
+        if (rc == SQLITE_ROW || rc == SQLITE_DONE)
+            rc = SQLITE_OK;
+    }
+    return rc;
+}
+
+
+int EasyDB::AddIndex(const string & tableName, const string & columnName, const SortOrder & sortOrder)
+{
+    return AddIndex(tableName, IndexDef().Column(columnName, sortOrder));
+}
+
+int EasyDB::AddIndex(const string & tableName, const IndexDef & index)
+{
+    if (index.columns.empty())
+        return SQLITE_MISUSE;
+    IndexDef created(index);
+    created.name = IndexName(tableName, index);
+
+    string zSql = string(index.unique ? "CREATE UNIQUE INDEX " : "CREATE INDEX ") + created.name + " on " + tableName + "(";
+    for (size_t i = 0; i < index.columns.size(); i++)
+        zSql += (i == 0 ? "" : ", ") + index.columns[i].name + (index.columns[i].order == Descending ? " DESC" : "");
+    for (auto & column : index.included)
+        zSql += ", " + column;
+    zSql += ")";
+    if (!index.predicate.empty())
+        zSql += " WHERE " + index.predicate;
+    zSql += ";";
+
+    int rc = sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
+    auto it = schemaCatalog.find(TableKey(tableName));
+    if (it != schemaCatalog.end())
+    {
+        if (SUCCESS(rc))
+            it->second.indexes.push_back(created);
+        else
+            schemaCatalog.erase(it);
+    }
+    //plans of the table's predicates may have changed
+    if (SUCCESS(rc))
+    {
+        string prefix = TableKey(tableName) + "\n";
+        for (auto & observed : observedPredicates)
+            if (observed.first.compare(0, prefix.size(), prefix) == 0)
+                observed.second.planned = false;
+    }
+    return rc;
+}
+
+int EasyDB::RemoveIndex(const string & tableName, const string & columnName)
+{
+    return RemoveIndex(tableName, IndexDef().Column(columnName));
+}
+
+int EasyDB::RemoveIndex(const string & tableName, const IndexDef & index)
+{
+    string indexName = IndexName(tableName, index);
+    string zSql = "DROP INDEX "+indexName+";";
+    int rc = sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
+    auto it = schemaCatalog.find(TableKey(tableName));
+    if (it != schemaCatalog.end())
+    {
+        vector<IndexDef> & indexes = it->second.indexes;
+        string key = TableKey(indexName);
+        for (auto entry = indexes.begin(); entry != indexes.end(); ++entry)
+        {
+            if (TableKey(entry->name) == key)
+            {
+                indexes.erase(entry);
+                break;
+            }
+        }
+    }
+    return rc;
+}
+
+int EasyDB::GetIndexes(const string & tableName, vector<IndexDef> & indexes)
+{
+	TableSchema* schema = NULL;
+	int rc = GetTableSchema(tableName, schema);
+	if (SUCCESS(rc))
+		indexes.insert(indexes.end(), schema->indexes.begin(), schema->indexes.end());
+	return rc;
+}
+
+int EasyDB::AddColumn(const string & tableName, const string & columnName)
+{
+	return AddColumn(tableName, ColumnDef(columnName));
+}
+
+int EasyDB::AddColumn(const string & tableName, const ColumnDef & column)
+{
+	bool exists = false;
+	int rc = TableExists(tableName, exists);
+	if (SUCCESS(rc))
+	{
+		if (!exists)
+			return rc;
+
+		InvalidateInsertStatement(tableName);
+		InvalidateCachedRows(tableName);
+		string zSql("ALTER TABLE " + tableName + " ADD " + ColumnSql(column));
+		rc = sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
+		if (SUCCESS(rc))
+		{
+			TableSchema & schema = schemaCatalog[TableKey(tableName)];
+			schema.columnNames.push_back(column.name);
+			schema.columnTypes.push_back(ColumnTypeName(column.type));
+		}
+		else
+			InvalidateTableSchema(tableName);
+	}
+	return rc;
+}
+
+unsigned int EasyDB::GetNumColumns(const string & tableName)
+{
+	TableSchema* schema = NULL;
+	if (SUCCESS(GetTableSchema(tableName, schema)))
+		return (unsigned int)schema->columnNames.size();
+	return 0;
+}
+
+unsigned int EasyDB::GetNumRows(const string & tableName)
+{
+	string key = TableKey(tableName);
+	auto pending = pendingRowCounts.find(key);
+	if (rowCountsEnabled)
+	{
+		if (pending != pendingRowCounts.end() && pending->second.truncated)
+			return (unsigned int)pending->second.delta;
+		auto known = rowCounts.find(key);
+		if (known != rowCounts.end())
+			return (unsigned int)(known->second + (pending != pendingRowCounts.end() ? pending->second.delta : 0));
+	}
+
+	int rows = 0;
+	Cursor cursor;
+	if (OpenCursor("SELECT COUNT(*) FROM " + tableName + ";", vector<FieldValue>(), cursor) == SQLITE_OK)
+	{
+		while (cursor.Next() == SQLITE_ROW)
+		{
+			rows = sqlite3_column_int(cursor.stmt, 0);
+			//a count that includes uncommitted changes can't seed the committed count
+			if (rowCountsEnabled && pending == pendingRowCounts.end())
+				rowCounts[key] = rows;
+		}
+	}
+	return rows;
+}
+
+void EasyDB::EnableQueryCache(size_t memoryBudget)
+{
+	queryCache.SetBudget(memoryBudget);
+	writtenTables.clear();
+	InstallHooks();
+}
+
+void EasyDB::GetQueryCacheStats(QueryCacheStats & stats) const
+{
+	queryCache.GetStats(stats);
+}
+
+//Cache key of a predicate query: the bound values are tagged with their type
+//and length so different values can't produce the same key
+string EasyDB::QueryKey(const string & tableName, const string & select, const string & predicate, const vector<FieldValue> & params)
+{
+	string key(TableKey(tableName));
+	key += '\n';
+	key += select;
+	key += '\n';
+	key += predicate;
+	for (auto & param : params)
+	{
+		string value = param.AsText();
+		key += '\n';
+		key += (char)('0' + param.GetType());
+		key += to_string(value.size());
+		key += ':';
+		key += value;
+	}
+	return key;
+}
+
+void EasyDB::EnableRowCountCache(bool enable)
+{
+	rowCountsEnabled = enable;
+	rowCounts.clear();
+	pendingRowCounts.clear();
+	committingTables.clear();
+	InstallHooks();
+}
+
+unsigned int EasyDB::GetEstimatedNumRows(const string & tableName)
+{
+	//first number of a stat1 row is the table's row count at the last ANALYZE
+	vector<FieldValue> params(1, FieldValue(tableName));
+	Cursor cursor;
+	if (OpenCursor("SELECT stat FROM sqlite_stat1 WHERE tbl = ? COLLATE NOCASE LIMIT 1;", params, cursor) == SQLITE_OK
+		&& cursor.Next() == SQLITE_ROW)
+	{
+		const char* stat = (const char*)sqlite3_column_text(cursor.stmt, 0);
+		if (stat != NULL)
+			return (unsigned int)strtoul(stat, NULL, 10);
+	}
+	cursor.Close();
+	return GetNumRows(tableName);
+}
+
+int EasyDB::Analyze(const string & tableName)
+{
+	string zSql("ANALYZE " + tableName + ";");
+	return sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
+}
+
+void EasyDB::InstallHooks()
+{
+	if (db == NULL)
+		return;
+	bool needed = rowCountsEnabled || CachingRows();
+	sqlite3_update_hook(db, needed ? UpdateHook : NULL, this);
+	sqlite3_commit_hook(db, needed ? CommitHook : NULL, this);
+	sqlite3_rollback_hook(db, needed ? RollbackHook : NULL, this);
+}
+
+void EasyDB::UpdateHook(void* easyDB, int op, const char*, const char* tableName, sqlite3_int64 rowid)
+{
+	((EasyDB*)easyDB)->OnRowChanged(op, tableName, rowid);
+}
+
+int EasyDB::CommitHook(void* easyDB)
+{
+	((EasyDB*)easyDB)->OnCommit();
+	return 0;
+}
+
+void EasyDB::RollbackHook(void* easyDB)
+{
+	((EasyDB*)easyDB)->OnRollback();
+}
+
+void EasyDB::OnRowChanged(int op, const char* tableName, sqlite3_int64 rowid)
+{
+	//a write after the last commit hook means that commit went through
+	committingTables.clear();
+	string key = TableKey(tableName);
+	if (CachingRows() && writtenTables.insert(key).second)
+		queryCache.Invalidate(key);
+	//a new RecordNumber can't be cached yet
+	if (op != SQLITE_INSERT)
+		InvalidateCachedRow(key, rowid);
+	if (rowCountsEnabled && op != SQLITE_UPDATE)
+	{
+		auto inserted = pendingRowCounts.insert(make_pair(key, RowCountDelta()));
+		RowCountDelta & pending = inserted.first->second;
+		if (inserted.second)
+		{
+			pending.truncated = false;
+			pending.delta = 0;
+		}
+		pending.delta += op == SQLITE_INSERT ? 1 : -1;
+	}
+}
+
+void EasyDB::OnCommit()
+{
+	//runs before the commit is durable; OnRollback undoes it if COMMIT fails
+	committingTables.clear();
+	for (auto & pending : pendingRowCounts)
+	{
+		committingTables.push_back(pending.first);
+		if (pending.second.truncated)
+			rowCounts[pending.first] = pending.second.delta;
+		else
+		{
+			auto known = rowCounts.find(pending.first);
+			if (known != rowCounts.end())
+				known->second += pending.second.delta;
+		}
+	}
+	pendingRowCounts.clear();
+	writtenTables.clear();
+}
+
+void EasyDB::OnRollback()
+{
+	for (auto & table : committingTables)
+		rowCounts.erase(table);
+	committingTables.clear();
+	pendingRowCounts.clear();
+	writtenTables.clear();
+}
+
+void EasyDB::InvalidateCachedRows(const string & tableName)
+{
+	string key = TableKey(tableName);
+	rowCounts.erase(key);
+	pendingRowCounts.erase(key);
+	queryCache.Invalidate(key);
+	InvalidateCachedRow(key, -1);
+}
+
+//recordNumber -1 drops the whole table
+void EasyDB::InvalidateCachedRow(const string & tableKey, int64_t recordNumber)
+{
+	if (rowCache == NULL)
+		return;
+	if (recordNumber == -1)
+		rowCache->InvalidateTable(tableKey);
+	else
+		rowCache->Invalidate(tableKey, recordNumber);
+	if (rowCache == ownedRowCache.get())
+		return;
+
+	auto inserted = rowCacheChanges.insert(make_pair(tableKey, RowChanges()));
+	RowChanges & changes = inserted.first->second;
+	if (inserted.second)
+		changes.wholeTable = false;
+	if (changes.wholeTable)
+		return;
+	if (recordNumber == -1 || changes.rows.size() >= 4096)
+	{
+		changes.wholeTable = true;
+		changes.rows.clear();
+	}
+	else
+		changes.rows.push_back(recordNumber);
+}
+
+void EasyDB::FlushRowCache()
+{
+	if (rowCache != NULL)
+	{
+		for (auto & changes : rowCacheChanges)
+		{
+			if (changes.second.wholeTable)
+				rowCache->InvalidateTable(changes.first);
+			for (auto recordNumber : changes.second.rows)
+				rowCache->Invalidate(changes.first, recordNumber);
+		}
+	}
+	rowCacheChanges.clear();
+}
+
+void EasyDB::SetSharedRowCache(RowCache* cache)
+{
+	rowCache = cache;
+	ownedRowCache.reset();
+	rowCacheChanges.clear();
+	InstallHooks();
+}
+
+void EasyDB::EnableRowCache(size_t defaultCapacity)
+{
+	if (rowCache == NULL)
+	{
+		ownedRowCache.reset(new RowCache());
+		rowCache = ownedRowCache.get();
+	}
+	rowCache->SetDefaultCapacity(defaultCapacity);
+	InstallHooks();
+}
+
+void EasyDB::SetRowCacheCapacity(const string & tableName, size_t capacity)
+{
+	if (rowCache == NULL)
+	{
+		ownedRowCache.reset(new RowCache());
+		rowCache = ownedRowCache.get();
+	}
+	rowCache->SetCapacity(TableKey(tableName), capacity);
+	InstallHooks();
+}
+
+void EasyDB::GetRowCacheStats(RowCacheStats & stats) const
+{
+	if (rowCache != NULL)
+		rowCache->GetStats(stats);
+	else
+		stats = RowCacheStats();
+}
+
+int EasyDB::DeleteTable(const string & tableName)
+{
+	InvalidateInsertStatement(tableName);
+	InvalidateCachedRows(tableName);
+	string zSql("DROP TABLE " + tableName);
+	int rc = sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
+	if (SUCCESS(rc))
+	{
+		TableSchema & schema = schemaCatalog[TableKey(tableName)];
+		schema.exists = false;
+		schema.columnNames.clear();
+		schema.columnTypes.clear();
+		schema.indexes.clear();
+	}
+	else
+		InvalidateTableSchema(tableName);
+	return rc;
+}
+
+//Index advisor
+void EasyDB::EnableIndexAdvisor(bool enable, unsigned long autoCreateThreshold)
+{
+	advisorEnabled = enable;
+	advisorThreshold = autoCreateThreshold;
+}
+
+void EasyDB::GetIndexSuggestions(vector<IndexSuggestion> & suggestions) const
+{
+	for (auto & observed : observedPredicates)
+		if ((observed.second.fullScan || observed.second.suggestion.created) && !observed.second.suggestion.index.columns.empty())
+			suggestions.push_back(observed.second.suggestion);
+	std::sort(suggestions.begin(), suggestions.end(), [](const IndexSuggestion & a, const IndexSuggestion & b)
+	{
+		return a.totalMicros > b.totalMicros;
+	});
+}
+
+void EasyDB::ResetIndexAdvisor()
+{
+	observedPredicates.clear();
+}
+
+//Predicates that differ only in their literals share one entry
+string EasyDB::PredicateShape(const string & predicate)
+{
+	string shape;
+	shape.reserve(predicate.size());
+	for (size_t i = 0; i < predicate.size(); i++)
+	{
+		char ch = predicate[i];
+		char previous = shape.empty() ? ' ' : shape[shape.size() - 1];
+		bool inName = isalnum((unsigned char)previous) || previous == '_';
+		if (ch == '\'')
+		{
+			//'' inside a string is an escaped quote
+			size_t end = i + 1;
+			while (end < predicate.size())
+			{
+				if (predicate[end] == '\'' && (end + 1 == predicate.size() || predicate[end + 1] != '\''))
+					break;
+				end += predicate[end] == '\'' ? 2 : 1;
+			}
+			i = end;
+			shape += '?';
+		}
+		else if (ch == '"' || ch == '`' || ch == '[')
+		{
+			//quoted identifiers are kept
+			size_t end = predicate.find(ch == '[' ? ']' : ch, i + 1);
+			end = end == string::npos ? predicate.size() - 1 : end;
+			shape.append(predicate, i, end - i + 1);
+			i = end;
+		}
+		else if (isdigit((unsigned char)ch) && !inName)
+		{
+			while (i + 1 < predicate.size() && (isalnum((unsigned char)predicate[i + 1]) || predicate[i + 1] == '.'))
+				i++;
+			shape += '?';
+		}
+		else
+			shape += ch;
+	}
+	return shape;
+}
+
+void EasyDB::ObservePredicate(const string & tableName, const string & rawPredicate, double micros)
+{
+	const size_t maxPredicates = 1024;
+	string predicate = PredicateShape(rawPredicate);
+	string key = TableKey(tableName) + "\n" + predicate;
+	auto found = observedPredicates.find(key);
+	if (found == observedPredicates.end() && observedPredicates.size() >= maxPredicates)
+	{
+		//make room by forgetting the cheapest predicate the advisor did not act on
+		auto cheapest = observedPredicates.end();
+		for (auto it = observedPredicates.begin(); it != observedPredicates.end(); ++it)
+			if (!it->second.suggestion.created && (cheapest == observedPredicates.end() ||
+				it->second.suggestion.totalMicros < cheapest->second.suggestion.totalMicros))
+				cheapest = it;
+		if (cheapest == observedPredicates.end())
+			return;
+		observedPredicates.erase(cheapest);
+	}
+	PredicateStats & observed = found != observedPredicates.end() ? found->second : observedPredicates[key];
+	if (observed.suggestion.tableName.empty())
+	{
+		observed.planned = false;
+		observed.fullScan = false;
+		observed.suggestion.tableName = tableName;
+		observed.suggestion.predicate = predicate;
+		observed.suggestion.calls = 0;
+		observed.suggestion.totalMicros = 0;
+		observed.suggestion.created = false;
+		SuggestIndex(tableName, predicate, observed.suggestion.index);
+	}
+	if (!observed.planned)
+	{
+		bool fullScan = false;
+		if (SUCCESS(ExplainPredicate(tableName, predicate, fullScan)))
+		{
+			observed.planned = true;
+			observed.fullScan = fullScan;
+		}
+	}
+	//only time spent scanning counts towards the ranking
+	if (!observed.fullScan)
+		return;
+
+	observed.suggestion.calls++;
+	observed.suggestion.totalMicros += micros;
+	if (advisorThreshold > 0 && observed.suggestion.calls >= advisorThreshold &&
+		!observed.suggestion.created && !observed.suggestion.index.columns.empty())
+	{
+		//AddIndex marks every predicate of the table for a new plan
+		if (SUCCESS(AddIndex(tableName, observed.suggestion.index)))
+			observed.suggestion.created = true;
+	}
+}
+
+int EasyDB::ExplainPredicate(const string & tableName, const string & predicate, bool & fullScan)
+{
+	//prepared outside the statement cache: each plan is only asked for once
+	fullScan = false;
+	string zSql("EXPLAIN QUERY PLAN SELECT * FROM " + tableName + " WHERE " + predicate);
+	sqlite3_stmt* stmt = NULL;
+	int rc = sqlite3_prepare_v2(db, VALUE(zSql), LENGTH(zSql), &stmt, 0);
+	if (rc != SQLITE_OK)
+	{
+		sqlite3_finalize(stmt);
+		return rc;
+	}
+	while ((rc = TryStep(stmt)) == SQLITE_ROW)
+	{
+		//detail is "SCAN TABLE t" (3.8) or "SCAN t" (3.24+) for a full scan,
+		//"SEARCH ..." when an index or the primary key is used
+		const char* detail = (const char*)sqlite3_column_text(stmt, 3);
+		if (detail != NULL && strncmp(detail, "SCAN ", 5) == 0)
+			fullScan = true;
+	}
+	sqlite3_finalize(stmt);
+	return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
+
+//Equality columns of an AND-only predicate first, then one range column; only
+//columns of the table count, and RecordNumber is already the primary key
+bool EasyDB::SuggestIndex(const string & tableName, const string & predicate, IndexDef & index)
+{
+	index.columns.clear();
+	TableSchema* schema = NULL;
+	if (!SUCCESS(GetTableSchema(tableName, schema)) || !schema->exists)
+		return false;
+	string upper = TableKey(predicate);
+	if (upper.find(" OR ") != string::npos)
+		return false;
+
+	vector<string> equality;
+	string range;
+	size_t start = 0;
+	while (start < upper.size())
+	{
+		size_t end = upper.find(" AND ", start);
+		if (end == string::npos)
+			end = upper.size();
+		size_t pos = upper.find_first_not_of(" (", start);
+		if (pos == string::npos || pos >= end)
+		{
+			start = end + 5;
+			continue;
+		}
+		size_t nameEnd = pos;
+		while (nameEnd < end && (isalnum((unsigned char)upper[nameEnd]) || upper[nameEnd] == '_'))
+			nameEnd++;
+		string column = predicate.substr(pos, nameEnd - pos);
+		size_t op = upper.find_first_not_of(' ', nameEnd);
+		start = end + 5;
+		if (column.empty() || op >= end || TableKey(column) == "RECORDNUMBER")
+			continue;
+
+		bool known = false;
+		for (auto & name : schema->columnNames)
+			if (TableKey(name) == TableKey(column))
+				known = true;
+		if (!known)
+			continue;
+		if (upper[op] == '=' || upper.compare(op, 3, "IS ") == 0 || upper.compare(op, 3, "IN ") == 0 || upper.compare(op, 3, "IN(") == 0)
+		{
+			if (std::find(equality.begin(), equality.end(), column) == equality.end())
+				equality.push_back(column);
+		}
+		else if (range.empty() && (upper[op] == '<' || upper[op] == '>' || upper.compare(op, 8, "BETWEEN ") == 0))
+			range = column;
+	}
+
+	for (auto & column : equality)
+		index.Column(column);
+	if (!range.empty() && std::find(equality.begin(), equality.end(), range) == equality.end())
+		index.Column(range);
+	return !index.columns.empty();
+}
+
+//FieldValue implementation
+FieldValue::FieldValue() : type(SQLITE_NULL), intValue(0), realValue(0)
+{
+}
+
+FieldValue::FieldValue(int value) : type(SQLITE_INTEGER), intValue(value), realValue(0)
+{
+}
+
+FieldValue::FieldValue(long value) : type(SQLITE_INTEGER), intValue(value), realValue(0)
+{
+}
+
+FieldValue::FieldValue(long long value) : type(SQLITE_INTEGER), intValue(value), realValue(0)
+{
+}
+
+FieldValue::FieldValue(double value) : type(SQLITE_FLOAT), intValue(0), realValue(value)
+{
+}
+
+FieldValue::FieldValue(const string & value) : type(SQLITE_TEXT), intValue(0), realValue(0), textValue(value)
+{
+}
+
+FieldValue FieldValue::Blob(const void* data, size_t size)
+{
+	FieldValue value;
+	value.type = SQLITE_BLOB;
+	value.textValue.assign((const char*)data, size);
+	return value;
+}
+
+FieldValue FieldValue::FromColumn(sqlite3_stmt* stmt, int col)
+{
+	switch (sqlite3_column_type(stmt, col))
+	{
+	case SQLITE_INTEGER:
+		return FieldValue(sqlite3_column_int64(stmt, col));
+	case SQLITE_FLOAT:
+		return FieldValue(sqlite3_column_double(stmt, col));
+	case SQLITE_TEXT:
+	{
+		const char* text = (const char*)sqlite3_column_text(stmt, col);
+		return FieldValue(string(text, sqlite3_column_bytes(stmt, col)));
+	}
+	case SQLITE_BLOB:
+		return Blob(sqlite3_column_blob(stmt, col), sqlite3_column_bytes(stmt, col));
+	default:
+		return FieldValue();
+	}
+}
+
+sqlite3_int64 FieldValue::AsInt64() const
+{
+	switch (type)
+	{
+	case SQLITE_INTEGER: return intValue;
+	case SQLITE_FLOAT: return (sqlite3_int64)realValue;
+	case SQLITE_TEXT: return strtoll(textValue.c_str(), NULL, 10);
+	default: return 0;
+	}
+}
+
+double FieldValue::AsDouble() const
+{
+	switch (type)
+	{
+	case SQLITE_INTEGER: return (double)intValue;
+	case SQLITE_FLOAT: return realValue;
+	case SQLITE_TEXT: return strtod(textValue.c_str(), NULL);
+	default: return 0;
+	}
+}
+
+string FieldValue::AsText() const
+{
+	switch (type)
+	{
+	case SQLITE_INTEGER: return std::to_string(intValue);
+	case SQLITE_FLOAT:
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%.17g", realValue);
+		return buffer;
+	}
+	case SQLITE_NULL: return string();
+	default: return textValue;
+	}
+}
+
+int FieldValue::Bind(sqlite3_stmt* stmt, int index) const
+{
+	//text and blobs are bound SQLITE_STATIC: the value must outlive the step
+	switch (type)
+	{
+	case SQLITE_INTEGER: return sqlite3_bind_int64(stmt, index, intValue);
+	case SQLITE_FLOAT: return sqlite3_bind_double(stmt, index, realValue);
+	case SQLITE_TEXT: return sqlite3_bind_text(stmt, index, VALUE(textValue), LENGTH(textValue), SQLITE_STATIC);
+	case SQLITE_BLOB: return sqlite3_bind_blob(stmt, index, textValue.data(), LENGTH(textValue), SQLITE_STATIC);
+	default: return sqlite3_bind_null(stmt, index);
+	}
+}
+
+string FieldValue::ToSqlLiteral() const
+{
+	static const char hex[] = "0123456789ABCDEF";
+	switch (type)
+	{
+	case SQLITE_INTEGER:
+	case SQLITE_FLOAT:
+		return AsText();
+	case SQLITE_TEXT:
+	{
+		string literal("'");
+		for (auto ch : textValue)
+		{
+			if (ch == '\'')
+				literal += '\'';
+			literal += ch;
+		}
+		return literal + "'";
+	}
+	case SQLITE_BLOB:
+	{
+		string literal("X'");
+		for (auto ch : textValue)
+		{
+			literal += hex[((unsigned char)ch) >> 4];
+			literal += hex[((unsigned char)ch) & 0x0F];
+		}
+		return literal + "'";
+	}
+	default:
+		return "NULL";
+	}
+}
+
+//OpenOptions implementation
+OpenOptions::OpenOptions()
+	: cacheSizeKiB(0), tempStore(-1), mmapSize(-1), pageSize(0)
+{
+}
+
+OpenOptions OpenOptions::FromProfile(OpenProfile profile)
+{
+	OpenOptions options;
+	switch (profile)
+	{
+	case ProfileDurable:
+		options.journalMode = "WAL";
+		options.synchronous = "FULL";
+		options.cacheSizeKiB = 8 * 1024;
+		options.tempStore = 0;
+		options.mmapSize = 0;
+		break;
+	case ProfileBalanced:
+		options.journalMode = "WAL";
+		options.synchronous = "NORMAL";
+		options.cacheSizeKiB = 64 * 1024;
+		options.tempStore = 2;
+		options.mmapSize = 256LL * 1024 * 1024;
+		break;
+	case ProfileBulkLoad:
+		options.journalMode = "WAL";
+		options.synchronous = "OFF";
+		options.cacheSizeKiB = 256 * 1024;
+		options.tempStore = 2;
+		options.mmapSize = 1024LL * 1024 * 1024;
+		break;
+	default:
+		break;
+	}
+	if (profile != ProfileDefault)
+		options.pageSize = 4096;
+	return options;
+}
+
+//BusyPolicy implementation
+BusyPolicy::BusyPolicy()
+	: initialBackoffMicros(100), maxBackoffMicros(50000), backoffMultiplier(2.0),
+	jitter(0.5), timeoutMillis(5000)
+{
+}
+
+//Where implementation
+Where::Where(const string & column) : predicate(column)
+{
+}
+
+Where & Where::Compare(const char* op, const FieldValue & value)
+{
+	predicate = predicate + " " + op + " ?";
+	params.push_back(value);
+	return *this;
+}
+
+Where & Where::Eq(const FieldValue & value) { return Compare("=", value); }
+Where & Where::Ne(const FieldValue & value) { return Compare("<>", value); }
+Where & Where::Lt(const FieldValue & value) { return Compare("<", value); }
+Where & Where::Le(const FieldValue & value) { return Compare("<=", value); }
+Where & Where::Gt(const FieldValue & value) { return Compare(">", value); }
+Where & Where::Ge(const FieldValue & value) { return Compare(">=", value); }
+
+Where & Where::IsNull()
+{
+	predicate += " IS NULL";
+	return *this;
+}
+
+Where & Where::And(const string & column)
+{
+	predicate = predicate + " AND " + column;
+	return *this;
+}
+
+Where & Where::Or(const string & column)
+{
+	predicate = predicate + " OR " + column;
+	return *this;
+}
+
+//ColumnDef implementation
+ColumnDef::ColumnDef(const string & name, ColumnType type, bool notNull)
+	: name(name), type(type), notNull(notNull), hasDefault(false)
+{
+}
+
+ColumnDef::ColumnDef(const string & name, ColumnType type, bool notNull, const FieldValue & defaultValue)
+	: name(name), type(type), notNull(notNull), hasDefault(true), defaultValue(defaultValue)
 {
-	string zSql("DROP TABLE " + tableName);
-	return sqlite3_exec(db, VALUE(zSql), NULL, NULL, NULL);
 }
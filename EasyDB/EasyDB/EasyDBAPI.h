@@ -6,19 +6,36 @@
  * basic table(s) for quick storage and retrieval of data.
  *
  * With version 1.0 the following assumptions are made:
- * 1. All fields are TEXT fields int the database.
+ * 1. All fields are TEXT fields int the database, unless the table
+ *    is created from ColumnDef descriptors (INTEGER, REAL, BLOB).
  * 2. All tables will have an autoincrementing primary key: 
  *      RecordNumber type int
- * 3. No secondary Indexes - so table scans at this point. 
- * 4. Number of records needs to be kept down since there are no
- *    secondary indexes
+ * 3. Secondary indexes are only created through AddIndex; the opt-in
+ *    index advisor (EnableIndexAdvisor) points out predicates that
+ *    still scan the table.
+ * 4. Number of records needs to be kept down on tables that are
+ *    searched without an index
  ****************************************************************/
 #ifndef EasyDBAPI_h
 #define EasyDBAPI_h
 
 #include <string>
 #include "sqlite3.h"
+#include "StatementCache.h"
+#include "QueryCache.h"
+#include "RowCache.h"
 #include <vector>
+#include <map>
+#include <set>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#if __cplusplus >= 201703L
+  #include <string_view>
+#endif
 
 using namespace std;
 
@@ -30,37 +47,521 @@ using namespace std;
 
 enum SortOrder { Ascending = 1, Descending = 2 };
 
+enum OpenProfile { ProfileDefault = 0, ProfileDurable = 1, ProfileBalanced = 2, ProfileBulkLoad = 3 };
+
+enum ColumnType { ColumnText = 1, ColumnInteger = 2, ColumnReal = 3, ColumnBlob = 4 };
+
+//Throughput of the last AddRecords batch or chunked delete
+struct BatchStats
+{
+	unsigned long rows;
+	double elapsedSeconds;
+	double rowsPerSecond;
+};
+
 
 namespace openS3
 {
+	//Non-owning view of a column value (a std::string_view stand-in that also
+	//builds as C++11). Points into SQLite's buffer for the current row.
+	class FieldView
+	{
+	public:
+		FieldView() : data(NULL), size(0) {}
+		FieldView(const char* data, size_t size) : data(data), size(size) {}
+		const char* Data() const { return data; }
+		size_t Size() const { return size; }
+		bool Empty() const { return size == 0; }
+		string ToString() const { return data != NULL ? string(data, size) : string(); }
+		bool operator==(const char* other) const { return other != NULL && strlen(other) == size && (size == 0 || memcmp(data, other, size) == 0); }
+		bool operator==(const string & other) const { return other.size() == size && (size == 0 || memcmp(data, other.data(), size) == 0); }
+#if __cplusplus >= 201703L
+		operator std::string_view() const { return std::string_view(data, size); }
+#endif
+
+	private:
+		const char* data;
+		size_t size;
+	};
+
+	//View of the cursor's current row. Values (and FieldViews taken from it) are
+	//only valid until the cursor advances or closes; nothing is copied or allocated.
+	class RowView
+	{
+	public:
+		explicit RowView(sqlite3_stmt* stmt) : stmt(stmt) {}
+		int GetColumnCount() const;
+		bool IsNull(int col) const;
+		FieldView GetText(int col) const;
+		FieldView GetBlob(int col) const;
+		sqlite3_int64 GetInt64(int col) const;
+		double GetDouble(int col) const;
+
+	private:
+		sqlite3_stmt* stmt;
+	};
+
+	//A typed column value, bound and read with the matching sqlite3_bind_*/
+	//sqlite3_column_* call so numbers never round-trip through text.
+	//GetType() returns SQLITE_NULL, SQLITE_INTEGER, SQLITE_FLOAT, SQLITE_TEXT or SQLITE_BLOB.
+	class FieldValue
+	{
+	public:
+		FieldValue();
+		FieldValue(int value);
+		FieldValue(long value);
+		FieldValue(long long value);
+		FieldValue(double value);
+		//no const char* overload on purpose: braced lists of string literals
+		//must keep resolving to the vector<string> APIs
+		FieldValue(const string & value);
+		static FieldValue Blob(const void* data, size_t size);
+		static FieldValue FromColumn(sqlite3_stmt* stmt, int col);
+
+		int GetType() const { return type; }
+		bool IsNull() const { return type == SQLITE_NULL; }
+		sqlite3_int64 AsInt64() const;
+		double AsDouble() const;
+		//Text (or blob bytes); numbers are formatted
+		string AsText() const;
+		int Bind(sqlite3_stmt* stmt, int index) const;
+		//Value as a SQL literal, e.g. for a DEFAULT clause
+		string ToSqlLiteral() const;
+
+	private:
+		int type;
+		sqlite3_int64 intValue;
+		double realValue;
+		string textValue;
+	};
+
+	//One key column of an index
+	struct IndexColumn
+	{
+		IndexColumn(const string & name, SortOrder order = Ascending) : name(name), order(order) {}
+		string name;
+		SortOrder order;
+	};
+
+	//Index descriptor for AddIndex, e.g.
+	//  IndexDef().Column("LastName").Column("Age", Descending).Include("Email").Partial("Active = 1")
+	//Included columns are appended to the key so lookups that only read them are
+	//answered from the index (SQLite has no INCLUDE clause); indexes read back from
+	//the database report them as ordinary key columns.
+	struct IndexDef
+	{
+		IndexDef() : unique(false) {}
+		explicit IndexDef(const string & name) : name(name), unique(false) {}
+		IndexDef & Column(const string & column, SortOrder order = Ascending) { columns.push_back(IndexColumn(column, order)); return *this; }
+		IndexDef & Include(const string & column) { included.push_back(column); return *this; }
+		IndexDef & Unique(bool isUnique = true) { unique = isUnique; return *this; }
+		IndexDef & Partial(const string & wherePredicate) { predicate = wherePredicate; return *this; }
+
+		string name;					//empty: IDX_<table>_<column>_<column>...
+		vector<IndexColumn> columns;
+		vector<string> included;
+		bool unique;
+		string predicate;				//empty unless partial
+	};
+
+	//A predicate the index advisor saw scanning a table, with the index that
+	//would turn the scan into a seek
+	struct IndexSuggestion
+	{
+		string tableName;
+		string predicate;			//literals replaced by ?
+		IndexDef index;
+		unsigned long calls;		//GetRecord/DeleteRecord calls with this predicate
+		double totalMicros;			//time spent in those calls
+		bool created;				//created by the advisor
+	};
+
+	//One end of a ScanRange; default constructed = unbounded
+	struct RangeBound
+	{
+		RangeBound() : bounded(false), inclusive(true) {}
+		RangeBound(const FieldValue & value, bool inclusive = true) : bounded(true), inclusive(inclusive), value(value) {}
+		bool bounded;
+		bool inclusive;
+		FieldValue value;
+	};
+
+	//Where the next page of an ordered GetPage starts; default constructed = first page
+	struct PageKey
+	{
+		PageKey() : started(false), recordNumber(0) {}
+		bool started;
+		FieldValue value;			//orderColumn of the last row returned
+		long long recordNumber;		//RecordNumber of the last row returned
+	};
+
+	//Column descriptor for CreateTable/AddColumn
+	struct ColumnDef
+	{
+		ColumnDef(const string & name, ColumnType type = ColumnText, bool notNull = false);
+		ColumnDef(const string & name, ColumnType type, bool notNull, const FieldValue & defaultValue);
+
+		string name;
+		ColumnType type;
+		bool notNull;
+		bool hasDefault;
+		FieldValue defaultValue;
+	};
+
+	//How a connection waits on SQLITE_BUSY: exponential backoff with jitter,
+	//bounded by a total deadline per busy event.
+	struct BusyPolicy
+	{
+		BusyPolicy();
+
+		unsigned int initialBackoffMicros;
+		unsigned int maxBackoffMicros;
+		double backoffMultiplier;
+		double jitter;				//0..1, fraction of each delay that is randomized
+		unsigned int timeoutMillis;	//0 = return SQLITE_BUSY immediately
+	};
+
+	struct BusyStats
+	{
+		unsigned long busyEvents;		//statements that hit a lock
+		unsigned long busyRetries;		//backoff sleeps taken
+		unsigned long busyTimeouts;		//events that gave up at the deadline
+		unsigned long long waitMicros;	//total time spent sleeping
+	};
+
+	//Connection settings applied as pragmas when the database is opened (or
+	//later via ApplyOptions). Empty/negative members leave SQLite's default.
+	struct OpenOptions
+	{
+		OpenOptions();
+		//durable: WAL + synchronous FULL, balanced: WAL + NORMAL with a large
+		//cache and mmap, bulk load: WAL + synchronous OFF for maintenance windows.
+		//All named profiles use WAL so they can be switched on an open connection.
+		static OpenOptions FromProfile(OpenProfile profile);
+
+		string journalMode;			//e.g. "WAL", "DELETE"
+		string synchronous;			//"OFF", "NORMAL" or "FULL"
+		int cacheSizeKiB;			//0 = unchanged
+		int tempStore;				//-1 = unchanged, 0 default, 1 file, 2 memory
+		long long mmapSize;			//-1 = unchanged, bytes
+		int pageSize;				//0 = unchanged, only takes effect on a new database
+	};
+
+	//Builds a parameterized predicate, e.g.
+	//  Where("LastName").Eq(FieldValue(name)).And("Age").Ge(FieldValue(21))
+	//gives "LastName = ? AND Age >= ?" plus the values to bind.
+	class Where
+	{
+	public:
+		explicit Where(const string & column);
+		Where & Eq(const FieldValue & value);
+		Where & Ne(const FieldValue & value);
+		Where & Lt(const FieldValue & value);
+		Where & Le(const FieldValue & value);
+		Where & Gt(const FieldValue & value);
+		Where & Ge(const FieldValue & value);
+		Where & IsNull();
+		Where & And(const string & column);
+		Where & Or(const string & column);
+		const string & GetPredicate() const { return predicate; }
+		const vector<FieldValue> & GetParams() const { return params; }
+
+	private:
+		Where & Compare(const char* op, const FieldValue & value);
+		string predicate;
+		vector<FieldValue> params;
+	};
+
+	template <typename NameTag, typename... Columns> class Table;
+
     class EasyDB
     {
     public:
+		//Forward-only cursor over a live statement, one row at a time.
+		//The statement goes back to the statement cache when the cursor is closed
+		//or goes out of scope, so a loop may stop early. Must not outlive the
+		//EasyDB that opened it.
+		class Cursor
+		{
+		public:
+			Cursor();
+			~Cursor();
+			Cursor(Cursor && other);
+			Cursor & operator=(Cursor && other);
+			//Advances to the next row: SQLITE_ROW, SQLITE_DONE or an error code
+			int Next();
+			bool IsOpen() const;
+			int GetColumnCount() const;
+			//Copies the current row, NULL columns are skipped (as GetRecords does)
+			void GetRow(vector<string> & row) const;
+			//Copies the current row with its storage types, NULL columns included
+			void GetTypedRow(vector<FieldValue> & row) const;
+			//Zero-copy access to the current row, valid until the next call to Next
+			RowView GetRowView() const;
+			void Close();
+
+		private:
+			Cursor(const Cursor &) = delete;
+			Cursor & operator=(const Cursor &) = delete;
+			friend class EasyDB;
+			sqlite3_stmt* stmt;
+			EasyDB* owner;	//set when stmt came from the statement cache
+			string sql;
+		};
+
         EasyDB();
         ~EasyDB();
         int InitializeDatabase(const string & dbName);
         int InitializeDatabase(const string & dbName, const string & folderPath);
+		int InitializeDatabase(const string & dbName, const string & folderPath, const OpenOptions & options);
+		//Re-applies pragmas on the open connection, e.g. ProfileBulkLoad for a
+		//maintenance window and back to ProfileBalanced afterwards
+		int ApplyOptions(const OpenOptions & options);
+		int SetProfile(OpenProfile profile);
         int CreateTable(const string & tableName, vector<string> & fieldList, const bool & overwrite = true);
+		int CreateTable(const string & tableName, const vector<ColumnDef> & columns, const bool & overwrite = true);
         int AddIndex(const string & tableName, const string & columnName, const SortOrder & sortOrder);
+		int AddIndex(const string & tableName, const IndexDef & index);
         int RemoveIndex(const string & tableName, const string & columnName);
-        int AddRecord(const string & tableName, vector<string> values);
-        int AddRecords(const string & tableName, vector<vector<string>> records);
+		int RemoveIndex(const string & tableName, const IndexDef & index);
+		//Indexes of the table from the schema catalog (including SQLite's own
+		//autoindexes, which have a name only)
+		int GetIndexes(const string & tableName, vector<IndexDef> & indexes);
+        int AddRecord(const string & tableName, const vector<string> & values);
+		//Inserts all records in a single transaction (joining the caller's transaction
+		//if one is open). Stops at the first failing row and rolls the batch back.
+        int AddRecords(const string & tableName, const vector<vector<string>> & records);
+        int AddRecords(const string & tableName, const vector<vector<string>> & records, BatchStats & stats);
+		//Typed inserts: values are bound by storage type (FieldValue) instead of text
+		int AddTypedRecord(const string & tableName, const vector<FieldValue> & values);
+		int AddTypedRecords(const string & tableName, const vector<vector<FieldValue>> & records);
+		//In-place update: SET columns[i] = values[i] on the rows matching the predicate
+		//(? placeholders bound from params). RecordNumber and indexes are kept.
+		int UpdateRecord(const string & tableName, const vector<string> & columns, const vector<FieldValue> & values, const string & predicate, const vector<FieldValue> & params);
+		int UpdateRecord(const string & tableName, const vector<string> & columns, const vector<FieldValue> & values, const Where & where);
+		//Rows hold a value for every column, as for AddTypedRecords. A row whose key
+		//columns match an existing record updates it in place, otherwise it is inserted.
+		//All rows go in one transaction (joining the caller's if one is open).
+		int UpsertRecords(const string & tableName, const vector<string> & keyColumns, const vector<vector<FieldValue>> & rows);
+		int BeginTransaction();
+		int CommitTransaction();
+		int RollbackTransaction();
+		//Work queued against a connection, e.g. by EasyDBAsync
+		typedef std::function<int(EasyDB &)> Operation;
+		//Runs ops in one transaction, each inside its own savepoint so a failing op
+		//is undone alone. results[i] is the result of ops[i]; returns the COMMIT
+		//result (on failure every op is rolled back and gets that result).
+		int RunGroup(const vector<Operation> & ops, vector<int> & results);
 		int GetFieldNames(const string & tableName, vector<string> & fieldNames);
 		int GetRecords(const string & tableName, vector<vector<string>> & records);
+		int GetTypedRecords(const string & tableName, vector<vector<FieldValue>> & records);
+		//Multi-get: rows[i] is the record with RecordNumber recordNumbers[i] and found[i]
+		//says whether it exists (rows[i] is empty otherwise). Lookups go out as IN lists
+		//of a few fixed sizes so the statements stay in the statement cache.
+		int GetRecords(const string & tableName, const vector<int64_t> & recordNumbers, vector<vector<string>> & rows, vector<bool> & found);
+		//Keyset pagination: up to limit rows with RecordNumber > afterRecordNumber, in
+		//RecordNumber order. Pass 0 for the first page and the RecordNumber of the last
+		//row (column 0) for the next one; each page is a seek, unlike OFFSET.
+		int GetPage(const string & tableName, long long afterRecordNumber, int limit, vector<vector<string>> & rows);
+		//Same, ordered by orderColumn with RecordNumber breaking ties. after is moved to
+		//the last row returned. Rows with NULL in orderColumn are not returned. Index
+		//orderColumn so every page is a seek.
+		int GetPage(const string & tableName, const string & orderColumn, const SortOrder & sortOrder, PageKey & after, int limit, vector<vector<string>> & rows);
+		//Called for every row of a ScanRange; return false to stop early
+		typedef std::function<bool(const RowView &)> RowCallback;
+		//Streams the rows with lo <= column <= hi (per the bounds' inclusive flags) in
+		//column order, ties by RecordNumber, from a cached statement. Index column (or
+		//use RecordNumber) so the range is a seek. Returns SQLITE_DONE at the end of
+		//the range or SQLITE_ROW if the callback stopped it.
+		int ScanRange(const string & tableName, const string & column, const RangeBound & lo, const RangeBound & hi, const RowCallback & callback);
+		int ScanRange(const string & tableName, const string & column, const RangeBound & lo, const RangeBound & hi, const SortOrder & sortOrder, const RowCallback & callback);
+		//Opens a cursor over every row of the table
+		int Scan(const string & tableName, Cursor & cursor);
 		int GetRecord(const string & tableName, const string & whereClause, vector<string> & record);
 		int GetRecord(const string & tableName, int rowIndex, vector<string> & record);
+		//predicate uses ? placeholders bound from params, so the compiled
+		//statement is cached and reused for every value
+		int GetRecord(const string & tableName, const string & predicate, const vector<FieldValue> & params, vector<string> & record);
+		int GetRecord(const string & tableName, const Where & where, vector<string> & record);
+		//Reads only the listed columns, so a covering index can answer the lookup
+		int GetRecord(const string & tableName, const vector<string> & columns, const string & predicate, const vector<FieldValue> & params, vector<string> & record);
         int DeleteRecords(const string & tableName);
         int DeleteRecord(const string & tableName, const string & whereClause);
+        int DeleteRecord(const string & tableName, const string & predicate, const vector<FieldValue> & params);
+        int DeleteRecord(const string & tableName, const Where & where);
+		//Purges: deletes the listed records / the rows with lo <= column <= hi in
+		//transactions of at most maxRowsPerTxn rows, so the write lock is released
+		//between chunks. Chunks already committed stay deleted if a later one fails;
+		//inside the caller's transaction nothing is committed. stats.rows = rows deleted.
+		int DeleteRecords(const string & tableName, const vector<int64_t> & recordNumbers, unsigned int maxRowsPerTxn = 10000);
+		int DeleteRecords(const string & tableName, const vector<int64_t> & recordNumbers, unsigned int maxRowsPerTxn, BatchStats & stats);
+		int DeleteRange(const string & tableName, const string & column, const RangeBound & lo, const RangeBound & hi, unsigned int maxRowsPerTxn = 10000);
+		int DeleteRange(const string & tableName, const string & column, const RangeBound & lo, const RangeBound & hi, unsigned int maxRowsPerTxn, BatchStats & stats);
 		int AddColumn(const string & tableName, const string & columnName);
+		int AddColumn(const string & tableName, const ColumnDef & column);
 		unsigned int GetNumColumns(const string & tableName);
 		unsigned int GetNumRows(const string & tableName);
+		//Opt-in: GetNumRows answers from per-table counters once a table has been
+		//counted. The counters follow every insert/delete made on this connection
+		//(update hook, applied on commit, dropped on rollback). Writes from other
+		//connections are not seen, so enable it on the writer, not on pool readers.
+		void EnableRowCountCache(bool enable);
+		//Row count from sqlite_stat1 (kept by Analyze); falls back to GetNumRows when
+		//the table has not been analyzed
+		unsigned int GetEstimatedNumRows(const string & tableName);
+		int Analyze(const string & tableName);
+		//Opt-in result cache for the predicate GetRecord calls, keyed by table, columns,
+		//predicate and bound values and kept within memoryBudget bytes (0 turns it off).
+		//Entries of a table are dropped when this connection changes it; writes from
+		//other connections are not seen, and predicates must only read tableName.
+		void EnableQueryCache(size_t memoryBudget);
+		void GetQueryCacheStats(QueryCacheStats & stats) const;
+		//Opt-in LRU cache of the rows read by GetRecord(tableName, rowIndex), kept in
+		//step with this connection's writes. defaultCapacity rows per table (0 = off),
+		//SetRowCacheCapacity overrides it for one table.
+		void EnableRowCache(size_t defaultCapacity);
+		void SetRowCacheCapacity(const string & tableName, size_t capacity);
+		void GetRowCacheStats(RowCacheStats & stats) const;
 		int DeleteTable(const string & tableName);
 		int TableExists(const string & tableName, bool &exists);
+		//Number of AddRecord calls that reused (hits) or had to compile (misses)
+		//a cached INSERT statement.
+		void GetInsertCacheStats(unsigned long & hits, unsigned long & misses) const;
+		//Drops the in-memory schema catalog (and cached INSERTs) so the next call
+		//reloads it. Only needed when the schema is changed outside this object.
+		void RefreshSchema();
+		//Installs the busy handler used by this connection (applied on open)
+		int SetBusyPolicy(const BusyPolicy & policy);
+		void GetBusyStats(BusyStats & stats) const;
+		void ResetBusyStats();
+		//Compiled statements kept for GetRecord/GetRecords/DeleteRecord/GetNumRows/...
+		void SetStatementCacheCapacity(size_t capacity);
+		void GetStatementCacheStats(StatementCacheStats & stats) const;
+		//Opt-in index advisor: records the predicates passed to GetRecord/DeleteRecord
+		//(literals replaced by ?, at most 1024 shapes), checks each new one with
+		//EXPLAIN QUERY PLAN and keeps those that scan the table. With autoCreateThreshold > 0 the suggested index is created (AddIndex)
+		//once a scanning predicate has been used that many times.
+		void EnableIndexAdvisor(bool enable, unsigned long autoCreateThreshold = 0);
+		//Suggestions ranked by time spent scanning, most expensive first (indexes the
+		//advisor created stay listed with created set)
+		void GetIndexSuggestions(vector<IndexSuggestion> & suggestions) const;
+		void ResetIndexAdvisor();
         
     protected:
+		//typed tables (EasyDBTable.h) share this connection
+		template <typename NameTag, typename... Columns> friend class Table;
+		//the pool checks the writer's schema_version on its own statement cache
+		friend class EasyDBPool;
+
+		//Schema catalog entry, loaded lazily from pragma table_info/sqlite_master and
+		//kept up to date by the EasyDB calls that change the schema.
+		struct TableSchema
+		{
+			bool exists;
+			vector<string> columnNames;	//includes RecordNumber
+			vector<string> columnTypes;
+			vector<IndexDef> indexes;
+		};
+
+		//Compiled INSERT kept alive per table, reset between rows
+		struct InsertStatement
+		{
+			sqlite3_stmt* stmt;
+		};
+
         sqlite3* db;
-        int TryStep(sqlite3_stmt* &stmt, int t, int r);
-        string GetInsertStatement(const string & tableName, unsigned long &fieldCount);
+		map<string, InsertStatement> insertStatements;
+		unsigned long insertCacheHits;
+		unsigned long insertCacheMisses;
+		map<string, TableSchema> schemaCatalog;
+		StatementCache statementCache;
+		BusyPolicy busyPolicy;
+		BusyStats busyStats;
+		std::chrono::steady_clock::time_point busyStart;
+		std::minstd_rand busyRandom;
+
+		//Index advisor state, keyed by table key + predicate
+		struct PredicateStats
+		{
+			bool planned;		//EXPLAIN QUERY PLAN has run since the last index change
+			bool fullScan;
+			IndexSuggestion suggestion;
+		};
+		bool advisorEnabled;
+		unsigned long advisorThreshold;
+		map<string, PredicateStats> observedPredicates;
+
+		//Row-count cache: committed counts of the tables counted so far, and the
+		//changes of the open transaction (truncated: the table was emptied first)
+		struct RowCountDelta
+		{
+			bool truncated;
+			long long delta;
+		};
+		bool rowCountsEnabled;
+		map<string, long long> rowCounts;
+		map<string, RowCountDelta> pendingRowCounts;
+		vector<string> committingTables;	//applied by the commit hook, undone if COMMIT fails
+
+		//Query and row caches; tables written by the open transaction are not cached
+		//until it ends (their rows are uncommitted)
+		QueryCache queryCache;
+		set<string> writtenTables;
+		RowCache* rowCache;					//owned, or shared by the connections of a pool
+		unique_ptr<RowCache> ownedRowCache;
+		//Rows updated/deleted since the last FlushRowCache, kept when the row cache is
+		//shared (wholeTable once too many rows changed)
+		struct RowChanges
+		{
+			bool wholeTable;
+			vector<int64_t> rows;
+		};
+		map<string, RowChanges> rowCacheChanges;
+
+        int TryStep(sqlite3_stmt* &stmt);
+		int OpenDatabase(const string & path, const OpenOptions & options);
+		static int BusyHandler(void* easyDB, int count);
+		//Connection hooks, installed while a cache needs them
+		void InstallHooks();
+		static void UpdateHook(void* easyDB, int op, const char* dbName, const char* tableName, sqlite3_int64 rowid);
+		static int CommitHook(void* easyDB);
+		static void RollbackHook(void* easyDB);
+		void OnRowChanged(int op, const char* tableName, sqlite3_int64 rowid);
+		void OnCommit();
+		void OnRollback();
+		//Forgets what the caches know about a table's rows (DDL, truncation)
+		void InvalidateCachedRows(const string & tableName);
+		bool CachingRows() const { return queryCache.GetBudget() > 0 || (rowCache != NULL && rowCache->IsActive()); }
+		void InvalidateCachedRow(const string & tableKey, int64_t recordNumber);
+		//Pool only: share its row cache, and drop the rows changed by the lease that
+		//just ended again, in case a reader stored them while the write was open
+		void SetSharedRowCache(RowCache* cache);
+		void FlushRowCache();
+		static string QueryKey(const string & tableName, const string & select, const string & predicate, const vector<FieldValue> & params);
+        int GetInsertStatement(const string & tableName, string & zSql);
+		int GetCachedInsert(const string & tableName, InsertStatement* &insert);
+		int InsertRow(InsertStatement* insert, const vector<string> & values);
+		int InsertTypedRow(InsertStatement* insert, const vector<FieldValue> & values);
+		void InvalidateInsertStatement(const string & tableName);
+		void ClearInsertStatements();
+		//recheckMissing loads a table cached as missing again (another connection
+		//may have created it since), for the calls that write to it
+		int GetTableSchema(const string & tableName, TableSchema* &schema, bool recheckMissing = false);
+		int LoadTableSchema(const string & tableName, TableSchema & schema);
+		void InvalidateTableSchema(const string & tableName);
+		void ObservePredicate(const string & tableName, const string & predicate, double micros);
+		int ExplainPredicate(const string & tableName, const string & predicate, bool & fullScan);
+		bool SuggestIndex(const string & tableName, const string & predicate, IndexDef & index);
+		static string PredicateShape(const string & predicate);
+		//Checks a compiled statement out of the cache (preparing it on a miss);
+		//ReleaseStatement resets it and puts it back.
+		int AcquireStatement(const string & zSql, sqlite3_stmt* &stmt);
+		void ReleaseStatement(const string & zSql, sqlite3_stmt* stmt);
+		void ClearStatements();
+		//Opens a cursor on a cached statement. Text/blob params are bound without
+		//copying and must stay alive until the cursor is done.
+		int OpenCursor(const string & zSql, const vector<FieldValue> & params, Cursor & cursor);
+		int ExecuteCached(const string & zSql, const vector<FieldValue> & params);
     };
 }
 
@@ -0,0 +1,248 @@
+//  Created by Michael Valverde
+//  MIT Licensed Open Source Project
+//
+
+#include "EasyDBAsync.h"
+
+using namespace openS3;
+
+EasyDBAsync::EasyDBAsync() : maxBatch(256), stopping(false), writerSleeping(false)
+{
+}
+
+EasyDBAsync::~EasyDBAsync()
+{
+	Stop();
+}
+
+int EasyDBAsync::Initialize(const string & dbName, const string & folderPath, size_t readerThreads)
+{
+	return Initialize(dbName, folderPath, readerThreads, OpenOptions::FromProfile(ProfileBalanced));
+}
+
+int EasyDBAsync::Initialize(const string & dbName, const string & folderPath, size_t readerThreads, const OpenOptions & options)
+{
+	if (writer.joinable())
+		return SQLITE_MISUSE;
+	int rc = pool.Initialize(dbName, folderPath, readerThreads, options);
+	if (!SUCCESS(rc))
+		return rc;
+	writer = thread(&EasyDBAsync::WriterLoop, this);
+	for (size_t i = 0; i < readerThreads; i++)
+		readers.push_back(thread(&EasyDBAsync::ReaderLoop, this));
+	return SQLITE_OK;
+}
+
+//Request implementation
+EasyDBAsync::Request::Request() : hasPromise(false)
+{
+}
+
+EasyDBAsync::Request::Request(Request && other) : op(std::move(other.op)), result(std::move(other.result)),
+	done(std::move(other.done)), hasPromise(other.hasPromise)
+{
+}
+
+EasyDBAsync::Request & EasyDBAsync::Request::operator=(Request && other)
+{
+	if (this != &other)
+	{
+		op = std::move(other.op);
+		result = std::move(other.result);
+		done = std::move(other.done);
+		hasPromise = other.hasPromise;
+	}
+	return *this;
+}
+
+void EasyDBAsync::SetMaxBatch(size_t maxBatch)
+{
+	this->maxBatch = maxBatch > 0 ? maxBatch : 1;
+}
+
+void EasyDBAsync::Stop()
+{
+	{
+		lock_guard<mutex> writeLock(writerMutex);
+		lock_guard<mutex> readLock(readMutex);
+		stopping = true;
+	}
+	writerWake.notify_one();
+	readWake.notify_all();
+	if (writer.joinable())
+		writer.join();
+	for (auto & reader : readers)
+		reader.join();
+	readers.clear();
+}
+
+void EasyDBAsync::Complete(Request & request, int rc)
+{
+	if (request.hasPromise)
+		request.result.set_value(rc);
+	if (request.done)
+		request.done(rc);
+}
+
+//Mutations
+void EasyDBAsync::Enqueue(Request && request)
+{
+	writes.Push(std::move(request));
+	//Push publishes the node and the writer publishes writerSleeping before
+	//checking Drained(), all seq_cst, so either the writer sees this node or we
+	//see it sleeping. It holds writerMutex from then until it waits, so taking
+	//the mutex before notifying cannot miss the wakeup.
+	if (writerSleeping)
+	{
+		lock_guard<mutex> lock(writerMutex);
+		writerWake.notify_one();
+	}
+}
+
+future<int> EasyDBAsync::Submit(const EasyDB::Operation & op)
+{
+	Request request;
+	request.op = op;
+	request.hasPromise = true;
+	future<int> result = request.result.get_future();
+	Enqueue(std::move(request));
+	return result;
+}
+
+void EasyDBAsync::Submit(const EasyDB::Operation & op, const Completion & done)
+{
+	Request request;
+	request.op = op;
+	request.done = done;
+	request.hasPromise = false;
+	Enqueue(std::move(request));
+}
+
+future<int> EasyDBAsync::AddRecordAsync(const string & tableName, const vector<string> & values)
+{
+	return Submit([tableName, values](EasyDB & db) { return db.AddRecord(tableName, values); });
+}
+
+future<int> EasyDBAsync::AddRecordsAsync(const string & tableName, const vector<vector<string>> & records)
+{
+	return Submit([tableName, records](EasyDB & db) { return db.AddRecords(tableName, records); });
+}
+
+future<int> EasyDBAsync::AddTypedRecordAsync(const string & tableName, const vector<FieldValue> & values)
+{
+	return Submit([tableName, values](EasyDB & db) { return db.AddTypedRecord(tableName, values); });
+}
+
+future<int> EasyDBAsync::DeleteRecordAsync(const string & tableName, const string & whereClause)
+{
+	return Submit([tableName, whereClause](EasyDB & db) { return db.DeleteRecord(tableName, whereClause); });
+}
+
+future<int> EasyDBAsync::DeleteRecordAsync(const string & tableName, const string & predicate, const vector<FieldValue> & params)
+{
+	return Submit([tableName, predicate, params](EasyDB & db) { return db.DeleteRecord(tableName, predicate, params); });
+}
+
+void EasyDBAsync::Flush()
+{
+	Submit([](EasyDB &) { return SQLITE_OK; }).wait();
+}
+
+void EasyDBAsync::WriterLoop()
+{
+	vector<Request> batch;
+	vector<EasyDB::Operation> ops;
+	vector<int> results;
+	Request request;
+	while (true)
+	{
+		while (batch.size() < maxBatch && writes.Pop(request))
+			batch.push_back(std::move(request));
+
+		if (batch.empty())
+		{
+			unique_lock<mutex> lock(writerMutex);
+			if (stopping && writes.Empty())
+				break;
+			writerSleeping = true;
+			//a node that is pushed but not linked yet keeps us spinning here
+			//until Pop can take it
+			if (writes.Drained() && !stopping)
+				writerWake.wait(lock);
+			writerSleeping = false;
+			continue;
+		}
+
+		ops.clear();
+		for (auto & queued : batch)
+			ops.push_back(queued.op);
+		{
+			EasyDBPool::Lease lease = pool.AcquireWriter();
+			lease->RunGroup(ops, results);
+		}
+		for (size_t i = 0; i < batch.size(); i++)
+			Complete(batch[i], results[i]);
+		batch.clear();
+	}
+}
+
+//Reads
+future<int> EasyDBAsync::Read(const EasyDB::Operation & op)
+{
+	Request request;
+	request.op = op;
+	request.hasPromise = true;
+	future<int> result = request.result.get_future();
+	{
+		lock_guard<mutex> lock(readMutex);
+		reads.push_back(std::move(request));
+	}
+	readWake.notify_one();
+	return result;
+}
+
+future<int> EasyDBAsync::GetRecordsAsync(const string & tableName, vector<vector<string>> & records)
+{
+	vector<vector<string>>* out = &records;
+	return Read([tableName, out](EasyDB & db) { return db.GetRecords(tableName, *out); });
+}
+
+future<int> EasyDBAsync::GetRecordAsync(const string & tableName, int rowIndex, vector<string> & record)
+{
+	vector<string>* out = &record;
+	return Read([tableName, rowIndex, out](EasyDB & db) { return db.GetRecord(tableName, rowIndex, *out); });
+}
+
+future<int> EasyDBAsync::GetRecordAsync(const string & tableName, const string & predicate, const vector<FieldValue> & params, vector<string> & record)
+{
+	vector<string>* out = &record;
+	return Read([tableName, predicate, params, out](EasyDB & db) { return db.GetRecord(tableName, predicate, params, *out); });
+}
+
+future<int> EasyDBAsync::GetNumRowsAsync(const string & tableName, unsigned int & rows)
+{
+	unsigned int* out = &rows;
+	return Read([tableName, out](EasyDB & db) { *out = db.GetNumRows(tableName); return SQLITE_OK; });
+}
+
+void EasyDBAsync::ReaderLoop()
+{
+	while (true)
+	{
+		Request request;
+		{
+			unique_lock<mutex> lock(readMutex);
+			readWake.wait(lock, [this]() { return stopping || !reads.empty(); });
+			if (reads.empty())
+				break;
+			request = std::move(reads.front());
+			reads.pop_front();
+		}
+		int rc;
+		{
+			EasyDBPool::Lease lease = pool.AcquireReader();
+			rc = request.op(*lease);
+		}
+		Complete(request, rc);
+	}
+}
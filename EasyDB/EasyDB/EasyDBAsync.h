@@ -0,0 +1,169 @@
+/*****************************************************************
+ * Created by Michael Valverde
+ * MIT Licensed Open Source Project
+ * EasyDBAsync is an asynchronous facade over an EasyDBPool.
+ *
+ * Mutations are pushed on a lock-free multi-producer/single-consumer
+ * queue and run by one writer thread, so request threads never wait
+ * on disk I/O or busy retries. The writer drains whatever is queued
+ * (up to the batch limit) and commits it as one transaction, each
+ * operation in its own savepoint (EasyDB::RunGroup), so many small
+ * writes share one commit while a failing one only undoes itself.
+ * Completion is reported through a std::future or a callback, after
+ * the transaction has committed.
+ *
+ * Reads run on a small pool of reader threads, each using a reader
+ * connection of the pool.
+ *
+ * Operations run inside the writer's transaction, so they must not
+ * call Begin/Commit/RollbackTransaction themselves.
+ ****************************************************************/
+#ifndef EasyDBAsync_h
+#define EasyDBAsync_h
+
+#include "EasyDBPool.h"
+#include <atomic>
+#include <future>
+#include <thread>
+#include <deque>
+
+using namespace std;
+
+namespace openS3
+{
+	//Vyukov's intrusive MPSC queue: Push is wait-free for any number of
+	//producers, Pop may only be called from one consumer thread.
+	template <typename T>
+	class MpscQueue
+	{
+	public:
+		MpscQueue() : head(new Node), tail(head.load()) {}
+		~MpscQueue()
+		{
+			T value;
+			while (Pop(value))
+				;
+			delete tail;
+		}
+
+		void Push(T && value)
+		{
+			Node* node = new Node;
+			node->value = std::move(value);
+			//seq_cst: pairs with the consumer's Drained() check (see EasyDBAsync::Enqueue)
+			Node* prev = head.exchange(node);
+			prev->next.store(node, std::memory_order_release);
+		}
+
+		bool Pop(T & value)
+		{
+			Node* next = tail->next.load(std::memory_order_acquire);
+			if (next == NULL)
+				return false;
+			value = std::move(next->value);
+			delete tail;
+			tail = next;
+			return true;
+		}
+
+		bool Empty() const
+		{
+			return tail->next.load(std::memory_order_acquire) == NULL;
+		}
+
+		//Consumer only: true when no Push has started since the queue was last
+		//emptied. Unlike Empty() it also sees a Push that has not linked its node yet.
+		bool Drained() const
+		{
+			return head.load() == tail;
+		}
+
+	private:
+		struct Node
+		{
+			Node() : next(NULL) {}
+			atomic<Node*> next;
+			T value;
+		};
+
+		MpscQueue(const MpscQueue &) = delete;
+		MpscQueue & operator=(const MpscQueue &) = delete;
+
+		atomic<Node*> head;	//producers
+		Node* tail;			//consumer, always a drained dummy node
+	};
+
+	class EasyDBAsync
+	{
+	public:
+		typedef std::function<void(int)> Completion;
+
+		EasyDBAsync();
+		//Finishes every queued operation before returning
+		~EasyDBAsync();
+		int Initialize(const string & dbName, const string & folderPath, size_t readerThreads);
+		int Initialize(const string & dbName, const string & folderPath, size_t readerThreads, const OpenOptions & options);
+		//Most operations the writer commits in one transaction (default 256)
+		void SetMaxBatch(size_t maxBatch);
+		EasyDBPool & GetPool() { return pool; }
+
+		//Mutations, run on the writer thread
+		future<int> Submit(const EasyDB::Operation & op);
+		void Submit(const EasyDB::Operation & op, const Completion & done);
+		future<int> AddRecordAsync(const string & tableName, const vector<string> & values);
+		future<int> AddRecordsAsync(const string & tableName, const vector<vector<string>> & records);
+		future<int> AddTypedRecordAsync(const string & tableName, const vector<FieldValue> & values);
+		future<int> DeleteRecordAsync(const string & tableName, const string & whereClause);
+		future<int> DeleteRecordAsync(const string & tableName, const string & predicate, const vector<FieldValue> & params);
+		//Waits until everything submitted so far has committed
+		void Flush();
+
+		//Reads, run on a reader thread. Output arguments must stay alive until
+		//the future is ready.
+		future<int> Read(const EasyDB::Operation & op);
+		future<int> GetRecordsAsync(const string & tableName, vector<vector<string>> & records);
+		future<int> GetRecordAsync(const string & tableName, int rowIndex, vector<string> & record);
+		future<int> GetRecordAsync(const string & tableName, const string & predicate, const vector<FieldValue> & params, vector<string> & record);
+		future<int> GetNumRowsAsync(const string & tableName, unsigned int & rows);
+
+	protected:
+		//Moves are spelled out: VS2013 doesn't generate them, and the promise
+		//can't be copied
+		struct Request
+		{
+			Request();
+			Request(Request && other);
+			Request & operator=(Request && other);
+
+			EasyDB::Operation op;
+			promise<int> result;
+			Completion done;
+			bool hasPromise;
+		};
+
+		EasyDBAsync(const EasyDBAsync &) = delete;
+		EasyDBAsync & operator=(const EasyDBAsync &) = delete;
+		void Enqueue(Request && request);
+		void WriterLoop();
+		void ReaderLoop();
+		void Stop();
+		static void Complete(Request & request, int rc);
+
+		EasyDBPool pool;
+		size_t maxBatch;
+		atomic<bool> stopping;
+
+		MpscQueue<Request> writes;
+		atomic<bool> writerSleeping;
+		mutex writerMutex;
+		condition_variable writerWake;
+		thread writer;
+
+		deque<Request> reads;
+		mutex readMutex;
+		condition_variable readWake;
+		vector<thread> readers;
+	};
+}
+
+#endif
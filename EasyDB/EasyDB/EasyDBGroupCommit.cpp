@@ -0,0 +1,149 @@
+//  Created by Michael Valverde
+//  MIT Licensed Open Source Project
+//
+
+#include "EasyDBGroupCommit.h"
+
+using namespace openS3;
+
+EasyDBGroupCommit::EasyDBGroupCommit(EasyDB & db) : db(&db), pool(NULL), windowMicros(0), maxGroupSize(64), leaderActive(false)
+{
+	ResetStats();
+}
+
+EasyDBGroupCommit::EasyDBGroupCommit(EasyDBPool & pool) : db(NULL), pool(&pool), windowMicros(0), maxGroupSize(64), leaderActive(false)
+{
+	ResetStats();
+}
+
+void EasyDBGroupCommit::SetWindow(unsigned int windowMicros, size_t maxGroupSize)
+{
+	lock_guard<mutex> lock(groupMutex);
+	this->windowMicros = windowMicros;
+	this->maxGroupSize = maxGroupSize > 0 ? maxGroupSize : 1;
+}
+
+void EasyDBGroupCommit::GetStats(GroupCommitStats & stats)
+{
+	lock_guard<mutex> lock(groupMutex);
+	stats.groups = groups;
+	stats.operations = operations;
+	stats.maxGroupSize = largestGroup;
+	stats.averageGroupSize = groups > 0 ? (double)operations / groups : 0;
+	stats.averageCommitMicros = groups > 0 ? commitMicros / groups : 0;
+	stats.maxCommitMicros = maxCommitMicros;
+}
+
+void EasyDBGroupCommit::ResetStats()
+{
+	groups = 0;
+	operations = 0;
+	largestGroup = 0;
+	commitMicros = 0;
+	maxCommitMicros = 0;
+}
+
+int EasyDBGroupCommit::Execute(const EasyDB::Operation & op)
+{
+	Pending self;
+	self.op = &op;
+	self.result = SQLITE_OK;
+	self.done = false;
+
+	unique_lock<mutex> lock(groupMutex);
+	pending.push_back(&self);
+	if (pending.size() >= maxGroupSize)
+		groupFull.notify_one();
+
+	while (!self.done)
+	{
+		//the previous leader has finished and left us queued: take over
+		if (!leaderActive)
+			LeadGroup(lock);
+		else
+			groupDone.wait(lock);
+	}
+	return self.result;
+}
+
+//Called with the lock held; returns with it held
+void EasyDBGroupCommit::LeadGroup(unique_lock<mutex> & lock)
+{
+	leaderActive = true;
+	if (windowMicros > 0)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(windowMicros);
+		groupFull.wait_until(lock, deadline, [this]() { return pending.size() >= maxGroupSize; });
+	}
+
+	vector<Pending*> group;
+	if (pending.size() > maxGroupSize)
+	{
+		group.assign(pending.begin(), pending.begin() + maxGroupSize);
+		pending.erase(pending.begin(), pending.begin() + maxGroupSize);
+	}
+	else
+		group.swap(pending);
+	lock.unlock();
+
+	vector<EasyDB::Operation> ops;
+	for (auto entry : group)
+		ops.push_back(*entry->op);
+	vector<int> results;
+	auto start = std::chrono::steady_clock::now();
+	if (pool != NULL)
+	{
+		EasyDBPool::Lease lease = pool->AcquireWriter();
+		lease->RunGroup(ops, results);
+	}
+	else
+		db->RunGroup(ops, results);
+	double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+	lock.lock();
+	for (size_t i = 0; i < group.size(); i++)
+	{
+		group[i]->result = results[i];
+		group[i]->done = true;
+	}
+	groups++;
+	operations += (unsigned long)group.size();
+	if (group.size() > largestGroup)
+		largestGroup = (unsigned long)group.size();
+	commitMicros += micros;
+	if (micros > maxCommitMicros)
+		maxCommitMicros = micros;
+	leaderActive = false;
+	//wakes our followers and lets a writer left in pending take over as leader
+	groupDone.notify_all();
+}
+
+int EasyDBGroupCommit::AddRecord(const string & tableName, const vector<string> & values)
+{
+	return Execute([&](EasyDB & db) { return db.AddRecord(tableName, values); });
+}
+
+int EasyDBGroupCommit::AddRecords(const string & tableName, const vector<vector<string>> & records)
+{
+	return Execute([&](EasyDB & db) { return db.AddRecords(tableName, records); });
+}
+
+int EasyDBGroupCommit::AddTypedRecord(const string & tableName, const vector<FieldValue> & values)
+{
+	return Execute([&](EasyDB & db) { return db.AddTypedRecord(tableName, values); });
+}
+
+int EasyDBGroupCommit::DeleteRecord(const string & tableName, const string & whereClause)
+{
+	return Execute([&](EasyDB & db) { return db.DeleteRecord(tableName, whereClause); });
+}
+
+int EasyDBGroupCommit::DeleteRecord(const string & tableName, const string & predicate, const vector<FieldValue> & params)
+{
+	return Execute([&](EasyDB & db) { return db.DeleteRecord(tableName, predicate, params); });
+}
+
+int EasyDBGroupCommit::DeleteRecord(const string & tableName, const Where & where)
+{
+	return Execute([&](EasyDB & db) { return db.DeleteRecord(tableName, where); });
+}
@@ -0,0 +1,89 @@
+/*****************************************************************
+ * Created by Michael Valverde
+ * MIT Licensed Open Source Project
+ * EasyDBGroupCommit lets many threads write through one connection
+ * while sharing commits. The first caller to arrive becomes the
+ * commit leader: it waits for the window (a time limit or a number
+ * of writes, whichever comes first), then runs every write that
+ * arrived meanwhile in one transaction (EasyDB::RunGroup) and wakes
+ * the followers. Each caller still gets the result of its own write;
+ * a failing write is rolled back alone through its savepoint.
+ *
+ * Calls block until their group has committed, so a successful
+ * return has the same durability as a plain AddRecord.
+ ****************************************************************/
+#ifndef EasyDBGroupCommit_h
+#define EasyDBGroupCommit_h
+
+#include "EasyDBPool.h"
+
+using namespace std;
+
+namespace openS3
+{
+	struct GroupCommitStats
+	{
+		unsigned long groups;
+		unsigned long operations;
+		unsigned long maxGroupSize;
+		double averageGroupSize;
+		double averageCommitMicros;	//time to run and commit one group
+		double maxCommitMicros;
+	};
+
+	class EasyDBGroupCommit
+	{
+	public:
+		//Writes through db; nothing else may use db while groups are running
+		explicit EasyDBGroupCommit(EasyDB & db);
+		//Writes through the pool's writer, leased once per group
+		explicit EasyDBGroupCommit(EasyDBPool & pool);
+
+		//The leader commits after windowMicros or once maxGroupSize writes are
+		//waiting. Defaults: 0 microseconds, 64 writes. With no window a group is
+		//whatever arrived while the previous group was committing, so a lone
+		//writer pays no extra latency.
+		void SetWindow(unsigned int windowMicros, size_t maxGroupSize);
+		void GetStats(GroupCommitStats & stats);
+		void ResetStats();
+
+		int Execute(const EasyDB::Operation & op);
+		int AddRecord(const string & tableName, const vector<string> & values);
+		int AddRecords(const string & tableName, const vector<vector<string>> & records);
+		int AddTypedRecord(const string & tableName, const vector<FieldValue> & values);
+		int DeleteRecord(const string & tableName, const string & whereClause);
+		int DeleteRecord(const string & tableName, const string & predicate, const vector<FieldValue> & params);
+		int DeleteRecord(const string & tableName, const Where & where);
+
+	protected:
+		struct Pending
+		{
+			const EasyDB::Operation* op;
+			int result;
+			bool done;
+		};
+
+		EasyDBGroupCommit(const EasyDBGroupCommit &) = delete;
+		EasyDBGroupCommit & operator=(const EasyDBGroupCommit &) = delete;
+		void LeadGroup(unique_lock<mutex> & lock);
+
+		EasyDB* db;
+		EasyDBPool* pool;
+		unsigned int windowMicros;
+		size_t maxGroupSize;
+
+		mutex groupMutex;
+		condition_variable groupFull;		//wakes the leader early
+		condition_variable groupDone;		//wakes followers
+		vector<Pending*> pending;
+		bool leaderActive;
+
+		unsigned long groups;
+		unsigned long operations;
+		unsigned long largestGroup;
+		double commitMicros;
+		double maxCommitMicros;
+	};
+}
+
+#endif
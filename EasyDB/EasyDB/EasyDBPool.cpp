@@ -0,0 +1,350 @@
+//  Created by Michael Valverde
+//  MIT Licensed Open Source Project
+//
+
+#include "EasyDBPool.h"
+#include <algorithm>
+
+using namespace openS3;
+
+//Lease implementation
+EasyDBPool::Lease::Lease() : pool(NULL), db(NULL), writer(false)
+{
+}
+
+EasyDBPool::Lease::Lease(Lease && other) : pool(other.pool), db(other.db), writer(other.writer)
+{
+	other.pool = NULL;
+	other.db = NULL;
+}
+
+EasyDBPool::Lease & EasyDBPool::Lease::operator=(Lease && other)
+{
+	if (this != &other)
+	{
+		Release();
+		pool = other.pool;
+		db = other.db;
+		writer = other.writer;
+		other.pool = NULL;
+		other.db = NULL;
+	}
+	return *this;
+}
+
+EasyDBPool::Lease::~Lease()
+{
+	Release();
+}
+
+void EasyDBPool::Lease::Release()
+{
+	if (db != NULL)
+		pool->ReleaseConnection(db, writer);
+	pool = NULL;
+	db = NULL;
+}
+
+//EasyDBPool implementation
+EasyDBPool::EasyDBPool() : writerBusy(false), schemaGeneration(0), writerSchemaVersion(0), rowCacheAttached(false)
+{
+}
+
+EasyDBPool::~EasyDBPool()
+{
+	Close();
+}
+
+void EasyDBPool::Close()
+{
+	for (auto reader : readers)
+		delete reader;
+	readers.clear();
+	idleReaders.clear();
+}
+
+int EasyDBPool::Initialize(const string & dbName, const string & folderPath, size_t readerCount)
+{
+	return Initialize(dbName, folderPath, readerCount, OpenOptions::FromProfile(ProfileBalanced));
+}
+
+int EasyDBPool::Initialize(const string & dbName, const string & folderPath, size_t readerCount, const OpenOptions & options)
+{
+	if (!readers.empty() || readerCount == 0)
+		return SQLITE_MISUSE;
+	OpenOptions walOptions = options;
+	walOptions.journalMode = "WAL";
+
+	//the writer goes first so the file is in WAL mode before readers attach
+	int rc = writer.InitializeDatabase(dbName, folderPath, walOptions);
+	if (!SUCCESS(rc))
+		return rc;
+	writerSchemaVersion = GetSchemaVersion();
+	for (size_t i = 0; i < readerCount; i++)
+	{
+		Reader* reader = new Reader;
+		reader->schemaGeneration = schemaGeneration;
+		readers.push_back(reader);
+		idleReaders.push_back(reader);
+		rc = reader->db.InitializeDatabase(dbName, folderPath, walOptions);
+		if (!SUCCESS(rc))
+		{
+			Close();
+			return rc;
+		}
+	}
+	return SQLITE_OK;
+}
+
+EasyDBPool::Lease EasyDBPool::AcquireReader()
+{
+	unique_lock<mutex> lock(poolMutex);
+	readerFree.wait(lock, [this]() { return !idleReaders.empty(); });
+	Reader* reader = idleReaders.back();
+	idleReaders.pop_back();
+	unsigned long generation = schemaGeneration;
+	lock.unlock();
+
+	if (reader->schemaGeneration != generation)
+	{
+		reader->db.RefreshSchema();
+		reader->schemaGeneration = generation;
+	}
+	Lease lease;
+	lease.pool = this;
+	lease.db = &reader->db;
+	lease.writer = false;
+	return lease;
+}
+
+EasyDBPool::Lease EasyDBPool::AcquireWriter()
+{
+	unique_lock<mutex> lock(poolMutex);
+	writerFree.wait(lock, [this]() { return !writerBusy; });
+	writerBusy = true;
+	lock.unlock();
+
+	Lease lease;
+	lease.pool = this;
+	lease.db = &writer;
+	lease.writer = true;
+	return lease;
+}
+
+void EasyDBPool::ReleaseConnection(EasyDB* db, bool isWriter)
+{
+	if (isWriter)
+	{
+		//the lease's transactions are over, so rows readers cached meanwhile can go
+		writer.FlushRowCache();
+		//any DDL run on the lease shows up as a new schema_version
+		int version = GetSchemaVersion();
+		lock_guard<mutex> lock(poolMutex);
+		if (version != writerSchemaVersion)
+		{
+			writerSchemaVersion = version;
+			schemaGeneration++;
+		}
+		writerBusy = false;
+		writerFree.notify_one();
+		return;
+	}
+
+	lock_guard<mutex> lock(poolMutex);
+	for (auto reader : readers)
+	{
+		if (&reader->db == db)
+		{
+			idleReaders.push_back(reader);
+			break;
+		}
+	}
+	readerFree.notify_one();
+}
+
+//Only called while holding the writer
+int EasyDBPool::GetSchemaVersion()
+{
+	int version = 0;
+	sqlite3_stmt* stmt = NULL;
+	string zSql("PRAGMA schema_version;");
+	if (writer.AcquireStatement(zSql, stmt) == SQLITE_OK)
+	{
+		if (writer.TryStep(stmt) == SQLITE_ROW)
+			version = sqlite3_column_int(stmt, 0);
+		writer.ReleaseStatement(zSql, stmt);
+	}
+	return version;
+}
+
+//Reads
+void EasyDBPool::EnableRowCache(size_t defaultCapacity)
+{
+	rowCache.SetDefaultCapacity(defaultCapacity);
+	AttachRowCache();
+}
+
+void EasyDBPool::SetRowCacheCapacity(const string & tableName, size_t capacity)
+{
+	//same key as EasyDB's caches: table names are case insensitive
+	string key(tableName);
+	transform(key.begin(), key.end(), key.begin(), ::toupper);
+	rowCache.SetCapacity(key, capacity);
+	AttachRowCache();
+}
+
+//Points every connection at the shared cache (and installs the writer's hooks)
+void EasyDBPool::AttachRowCache()
+{
+	{
+		lock_guard<mutex> lock(poolMutex);
+		if (rowCacheAttached || readers.empty())
+			return;
+		rowCacheAttached = true;
+	}
+	Lease writerLease = AcquireWriter();
+	writerLease->SetSharedRowCache(&rowCache);
+	vector<Lease> readerLeases;
+	for (size_t i = 0; i < readers.size(); i++)
+	{
+		readerLeases.push_back(AcquireReader());
+		readerLeases.back()->SetSharedRowCache(&rowCache);
+	}
+}
+
+void EasyDBPool::GetRowCacheStats(RowCacheStats & stats) const
+{
+	rowCache.GetStats(stats);
+}
+
+int EasyDBPool::GetRecords(const string & tableName, vector<vector<string>> & records)
+{
+	return AcquireReader()->GetRecords(tableName, records);
+}
+
+int EasyDBPool::GetRecord(const string & tableName, const string & whereClause, vector<string> & record)
+{
+	return AcquireReader()->GetRecord(tableName, whereClause, record);
+}
+
+int EasyDBPool::GetRecord(const string & tableName, int rowIndex, vector<string> & record)
+{
+	return AcquireReader()->GetRecord(tableName, rowIndex, record);
+}
+
+int EasyDBPool::GetRecord(const string & tableName, const string & predicate, const vector<FieldValue> & params, vector<string> & record)
+{
+	return AcquireReader()->GetRecord(tableName, predicate, params, record);
+}
+
+int EasyDBPool::GetRecord(const string & tableName, const Where & where, vector<string> & record)
+{
+	return AcquireReader()->GetRecord(tableName, where, record);
+}
+
+unsigned int EasyDBPool::GetNumRows(const string & tableName)
+{
+	return AcquireReader()->GetNumRows(tableName);
+}
+
+int EasyDBPool::TableExists(const string & tableName, bool & exists)
+{
+	return AcquireReader()->TableExists(tableName, exists);
+}
+
+//Mutations
+int EasyDBPool::CreateTable(const string & tableName, vector<string> & fieldList, const bool & overwrite)
+{
+	return AcquireWriter()->CreateTable(tableName, fieldList, overwrite);
+}
+
+int EasyDBPool::CreateTable(const string & tableName, const vector<ColumnDef> & columns, const bool & overwrite)
+{
+	return AcquireWriter()->CreateTable(tableName, columns, overwrite);
+}
+
+int EasyDBPool::AddIndex(const string & tableName, const string & columnName, const SortOrder & sortOrder)
+{
+	return AcquireWriter()->AddIndex(tableName, columnName, sortOrder);
+}
+
+int EasyDBPool::AddIndex(const string & tableName, const IndexDef & index)
+{
+	return AcquireWriter()->AddIndex(tableName, index);
+}
+
+int EasyDBPool::RemoveIndex(const string & tableName, const string & columnName)
+{
+	return AcquireWriter()->RemoveIndex(tableName, columnName);
+}
+
+int EasyDBPool::AddColumn(const string & tableName, const ColumnDef & column)
+{
+	return AcquireWriter()->AddColumn(tableName, column);
+}
+
+int EasyDBPool::DeleteTable(const string & tableName)
+{
+	return AcquireWriter()->DeleteTable(tableName);
+}
+
+int EasyDBPool::AddRecord(const string & tableName, const vector<string> & values)
+{
+	return AcquireWriter()->AddRecord(tableName, values);
+}
+
+int EasyDBPool::AddRecords(const string & tableName, const vector<vector<string>> & records)
+{
+	return AcquireWriter()->AddRecords(tableName, records);
+}
+
+int EasyDBPool::AddTypedRecord(const string & tableName, const vector<FieldValue> & values)
+{
+	return AcquireWriter()->AddTypedRecord(tableName, values);
+}
+
+int EasyDBPool::AddTypedRecords(const string & tableName, const vector<vector<FieldValue>> & records)
+{
+	return AcquireWriter()->AddTypedRecords(tableName, records);
+}
+
+int EasyDBPool::UpdateRecord(const string & tableName, const vector<string> & columns, const vector<FieldValue> & values, const string & predicate, const vector<FieldValue> & params)
+{
+	return AcquireWriter()->UpdateRecord(tableName, columns, values, predicate, params);
+}
+
+int EasyDBPool::UpsertRecords(const string & tableName, const vector<string> & keyColumns, const vector<vector<FieldValue>> & rows)
+{
+	return AcquireWriter()->UpsertRecords(tableName, keyColumns, rows);
+}
+
+int EasyDBPool::DeleteRecords(const string & tableName)
+{
+	return AcquireWriter()->DeleteRecords(tableName);
+}
+
+int EasyDBPool::DeleteRecord(const string & tableName, const string & whereClause)
+{
+	return AcquireWriter()->DeleteRecord(tableName, whereClause);
+}
+
+int EasyDBPool::DeleteRecord(const string & tableName, const string & predicate, const vector<FieldValue> & params)
+{
+	return AcquireWriter()->DeleteRecord(tableName, predicate, params);
+}
+
+int EasyDBPool::DeleteRecord(const string & tableName, const Where & where)
+{
+	return AcquireWriter()->DeleteRecord(tableName, where);
+}
+
+//Each call holds the writer lease for the whole purge, chunks included
+int EasyDBPool::DeleteRecords(const string & tableName, const vector<int64_t> & recordNumbers, unsigned int maxRowsPerTxn)
+{
+	return AcquireWriter()->DeleteRecords(tableName, recordNumbers, maxRowsPerTxn);
+}
+
+int EasyDBPool::DeleteRange(const string & tableName, const string & column, const RangeBound & lo, const RangeBound & hi, unsigned int maxRowsPerTxn)
+{
+	return AcquireWriter()->DeleteRange(tableName, column, lo, hi, maxRowsPerTxn);
+}
@@ -0,0 +1,131 @@
+/*****************************************************************
+ * Created by Michael Valverde
+ * MIT Licensed Open Source Project
+ * EasyDBPool owns several EasyDB connections to the same database
+ * file so a multi-threaded service does not have to serialize every
+ * call behind one mutex. The file is opened in WAL mode with one
+ * writer connection and N reader connections; readers never block
+ * the writer and do not block each other.
+ *
+ * Connections are handed out as leases (RAII). A lease is used by
+ * one thread at a time and goes back to the pool when it is
+ * released or goes out of scope. The convenience calls below take a
+ * lease for the duration of the call: reads go to a reader, anything
+ * that changes the database goes to the writer.
+ ****************************************************************/
+#ifndef EasyDBPool_h
+#define EasyDBPool_h
+
+#include "EasyDBAPI.h"
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+namespace openS3
+{
+	class EasyDBPool
+	{
+	public:
+		class Lease
+		{
+		public:
+			Lease();
+			Lease(Lease && other);
+			Lease & operator=(Lease && other);
+			~Lease();
+			EasyDB* operator->() const { return db; }
+			EasyDB & operator*() const { return *db; }
+			bool IsValid() const { return db != NULL; }
+			//Hands the connection back to the pool early
+			void Release();
+		private:
+			friend class EasyDBPool;
+			Lease(const Lease &) = delete;
+			Lease & operator=(const Lease &) = delete;
+			EasyDBPool* pool;
+			EasyDB* db;
+			bool writer;
+		};
+
+		EasyDBPool();
+		~EasyDBPool();
+		//Opens the writer (which switches the file to WAL) and readerCount readers.
+		//options.journalMode is forced to WAL.
+		int Initialize(const string & dbName, const string & folderPath, size_t readerCount);
+		int Initialize(const string & dbName, const string & folderPath, size_t readerCount, const OpenOptions & options);
+		//Block until a connection is free. Leases must not outlive the pool.
+		Lease AcquireReader();
+		Lease AcquireWriter();
+		size_t GetReaderCount() const { return readers.size(); }
+		//Row cache shared by the writer and every reader, in front of
+		//GetRecord(tableName, rowIndex). Rows written through the writer are dropped
+		//when they change and again when the writer lease ends, so readers can see a
+		//cached row up to the end of the writer lease that changed it.
+		//The first Enable/SetRowCacheCapacity call after Initialize waits until no
+		//connection is leased to attach the cache to all of them.
+		void EnableRowCache(size_t defaultCapacity);
+		void SetRowCacheCapacity(const string & tableName, size_t capacity);
+		void GetRowCacheStats(RowCacheStats & stats) const;
+
+		//Reads, routed to a reader connection
+		int GetRecords(const string & tableName, vector<vector<string>> & records);
+		int GetRecord(const string & tableName, const string & whereClause, vector<string> & record);
+		int GetRecord(const string & tableName, int rowIndex, vector<string> & record);
+		int GetRecord(const string & tableName, const string & predicate, const vector<FieldValue> & params, vector<string> & record);
+		int GetRecord(const string & tableName, const Where & where, vector<string> & record);
+		unsigned int GetNumRows(const string & tableName);
+		int TableExists(const string & tableName, bool & exists);
+
+		//Mutations, routed to the writer connection
+		int CreateTable(const string & tableName, vector<string> & fieldList, const bool & overwrite = true);
+		int CreateTable(const string & tableName, const vector<ColumnDef> & columns, const bool & overwrite = true);
+		int AddIndex(const string & tableName, const string & columnName, const SortOrder & sortOrder);
+		int AddIndex(const string & tableName, const IndexDef & index);
+		int RemoveIndex(const string & tableName, const string & columnName);
+		int AddColumn(const string & tableName, const ColumnDef & column);
+		int DeleteTable(const string & tableName);
+		int AddRecord(const string & tableName, const vector<string> & values);
+		int AddRecords(const string & tableName, const vector<vector<string>> & records);
+		int AddTypedRecord(const string & tableName, const vector<FieldValue> & values);
+		int AddTypedRecords(const string & tableName, const vector<vector<FieldValue>> & records);
+		int UpdateRecord(const string & tableName, const vector<string> & columns, const vector<FieldValue> & values, const string & predicate, const vector<FieldValue> & params);
+		int UpsertRecords(const string & tableName, const vector<string> & keyColumns, const vector<vector<FieldValue>> & rows);
+		int DeleteRecords(const string & tableName);
+		int DeleteRecord(const string & tableName, const string & whereClause);
+		int DeleteRecord(const string & tableName, const string & predicate, const vector<FieldValue> & params);
+		int DeleteRecord(const string & tableName, const Where & where);
+		int DeleteRecords(const string & tableName, const vector<int64_t> & recordNumbers, unsigned int maxRowsPerTxn = 10000);
+		int DeleteRange(const string & tableName, const string & column, const RangeBound & lo, const RangeBound & hi, unsigned int maxRowsPerTxn = 10000);
+
+	protected:
+		struct Reader
+		{
+			EasyDB db;
+			unsigned long schemaGeneration;	//generation its schema catalog was loaded at
+		};
+
+		EasyDBPool(const EasyDBPool &) = delete;
+		EasyDBPool & operator=(const EasyDBPool &) = delete;
+		void ReleaseConnection(EasyDB* db, bool writer);
+		int GetSchemaVersion();
+		void Close();
+		void AttachRowCache();
+
+		RowCache rowCache;	//declared first: the connections hold a pointer to it
+		EasyDB writer;
+		vector<Reader*> readers;
+		vector<Reader*> idleReaders;
+		bool writerBusy;
+		//bumped whenever the writer changes the schema; readers with an older
+		//generation drop their schema catalog and cached statements on lease
+		unsigned long schemaGeneration;
+		int writerSchemaVersion;
+		bool rowCacheAttached;
+		mutex poolMutex;
+		condition_variable readerFree;
+		condition_variable writerFree;
+	};
+}
+
+#endif
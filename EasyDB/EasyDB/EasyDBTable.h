@@ -0,0 +1,261 @@
+/*****************************************************************
+ * Created by Michael Valverde
+ * MIT Licensed Open Source Project
+ * Typed table layer on top of EasyDB. A table is declared once as
+ * a type and all SQL and bind/read calls are derived from it:
+ *
+ *   EASYDB_NAME(Person);
+ *   EASYDB_NAME(FirstName);
+ *   EASYDB_NAME(Age);
+ *   typedef Table<Person, Column<FirstName, string>,
+ *                 Column<Age, long long>> PersonTable;
+ *
+ *   PersonTable people(db);
+ *   people.Create();
+ *   people.Insert(PersonTable::Row("Michael", 42));
+ *
+ * The SQL text is built once per table type (not per call) and
+ * never consults the schema at runtime.
+ ****************************************************************/
+#ifndef EasyDBTable_h
+#define EasyDBTable_h
+
+#include "EasyDBAPI.h"
+#include <tuple>
+
+//Declares a name tag usable as a table or column name
+#define EASYDB_NAME(id) struct id { static const char* SqlName() { return #id; } }
+
+namespace openS3
+{
+	//Storage type and sqlite3_bind_*/sqlite3_column_* calls for a C++ type
+	template <typename T> struct ColumnTraits;
+
+	template <> struct ColumnTraits<int>
+	{
+		static ColumnType Type() { return ColumnInteger; }
+		static int Bind(sqlite3_stmt* stmt, int index, int value) { return sqlite3_bind_int(stmt, index, value); }
+		static void Read(sqlite3_stmt* stmt, int col, int & value) { value = sqlite3_column_int(stmt, col); }
+	};
+
+	template <> struct ColumnTraits<long>
+	{
+		static ColumnType Type() { return ColumnInteger; }
+		static int Bind(sqlite3_stmt* stmt, int index, long value) { return sqlite3_bind_int64(stmt, index, value); }
+		static void Read(sqlite3_stmt* stmt, int col, long & value) { value = (long)sqlite3_column_int64(stmt, col); }
+	};
+
+	template <> struct ColumnTraits<long long>
+	{
+		static ColumnType Type() { return ColumnInteger; }
+		static int Bind(sqlite3_stmt* stmt, int index, long long value) { return sqlite3_bind_int64(stmt, index, value); }
+		static void Read(sqlite3_stmt* stmt, int col, long long & value) { value = sqlite3_column_int64(stmt, col); }
+	};
+
+	template <> struct ColumnTraits<double>
+	{
+		static ColumnType Type() { return ColumnReal; }
+		static int Bind(sqlite3_stmt* stmt, int index, double value) { return sqlite3_bind_double(stmt, index, value); }
+		static void Read(sqlite3_stmt* stmt, int col, double & value) { value = sqlite3_column_double(stmt, col); }
+	};
+
+	template <> struct ColumnTraits<string>
+	{
+		static ColumnType Type() { return ColumnText; }
+		static int Bind(sqlite3_stmt* stmt, int index, const string & value)
+		{
+			return sqlite3_bind_text(stmt, index, VALUE(value), LENGTH(value), SQLITE_STATIC);
+		}
+		static void Read(sqlite3_stmt* stmt, int col, string & value)
+		{
+			const char* text = (const char*)sqlite3_column_text(stmt, col);
+			if (text != NULL)
+				value.assign(text, sqlite3_column_bytes(stmt, col));
+			else
+				value.clear();
+		}
+	};
+
+	template <> struct ColumnTraits<vector<unsigned char>>
+	{
+		static ColumnType Type() { return ColumnBlob; }
+		static int Bind(sqlite3_stmt* stmt, int index, const vector<unsigned char> & value)
+		{
+			return sqlite3_bind_blob(stmt, index, value.empty() ? NULL : &value[0], (int)value.size(), SQLITE_STATIC);
+		}
+		static void Read(sqlite3_stmt* stmt, int col, vector<unsigned char> & value)
+		{
+			const unsigned char* blob = (const unsigned char*)sqlite3_column_blob(stmt, col);
+			value.assign(blob, blob + (blob != NULL ? sqlite3_column_bytes(stmt, col) : 0));
+		}
+	};
+
+	template <typename NameTag, typename T>
+	struct Column
+	{
+		typedef NameTag Tag;
+		typedef T Type;
+	};
+
+	//Binds/reads tuple elements I..N-1 (C++11 has no index_sequence)
+	template <typename Row, size_t I, size_t N>
+	struct RowBinder
+	{
+		typedef typename std::tuple_element<I, Row>::type Type;
+		static int Bind(sqlite3_stmt* stmt, const Row & row)
+		{
+			int rc = ColumnTraits<Type>::Bind(stmt, (int)I + 1, std::get<I>(row));
+			if (rc != SQLITE_OK)
+				return rc;
+			return RowBinder<Row, I + 1, N>::Bind(stmt, row);
+		}
+		static void Read(sqlite3_stmt* stmt, Row & row)
+		{
+			ColumnTraits<Type>::Read(stmt, (int)I, std::get<I>(row));
+			RowBinder<Row, I + 1, N>::Read(stmt, row);
+		}
+	};
+
+	template <typename Row, size_t N>
+	struct RowBinder<Row, N, N>
+	{
+		static int Bind(sqlite3_stmt*, const Row &) { return SQLITE_OK; }
+		static void Read(sqlite3_stmt*, Row &) {}
+	};
+
+	//A table whose name and columns are part of its type. Uses the EasyDB's
+	//connection; must not outlive it.
+	template <typename NameTag, typename... Columns>
+	class Table
+	{
+	public:
+		typedef std::tuple<typename Columns::Type...> Row;
+
+		explicit Table(EasyDB & db) : easyDB(db), insertStmt(NULL), selectStmt(NULL)
+		{
+		}
+
+		~Table()
+		{
+			sqlite3_finalize(insertStmt);
+			sqlite3_finalize(selectStmt);
+		}
+
+		static const char* SqlName()
+		{
+			return NameTag::SqlName();
+		}
+
+		static const string & InsertSql()
+		{
+			static const string zSql = BuildInsertSql();
+			return zSql;
+		}
+
+		static const string & SelectSql()
+		{
+			static const string zSql = BuildSelectSql();
+			return zSql;
+		}
+
+		//Goes through EasyDB::CreateTable so its schema catalog stays coherent
+		int Create(bool overwrite = true)
+		{
+			const char* names[] = { Columns::Tag::SqlName()... };
+			ColumnType types[] = { ColumnTraits<typename Columns::Type>::Type()... };
+			vector<ColumnDef> columns;
+			for (size_t i = 0; i < sizeof...(Columns); i++)
+				columns.push_back(ColumnDef(names[i], types[i]));
+			return easyDB.CreateTable(SqlName(), columns, overwrite);
+		}
+
+		int Insert(const Row & row)
+		{
+			int rc = Prepare(InsertSql(), insertStmt);
+			if (!SUCCESS(rc))
+				return rc;
+			//a failed bind is returned as is, reset only reports a step's error
+			rc = RowBinder<Row, 0, sizeof...(Columns)>::Bind(insertStmt, row);
+			if (rc == SQLITE_OK)
+			{
+				sqlite3_step(insertStmt);
+				rc = sqlite3_reset(insertStmt);
+			}
+			else
+				sqlite3_reset(insertStmt);
+			sqlite3_clear_bindings(insertStmt);
+			return rc;
+		}
+
+		//All rows in one transaction (or the caller's, if one is open)
+		int Insert(const vector<Row> & rows)
+		{
+			bool ownTransaction = sqlite3_get_autocommit(easyDB.db) != 0;
+			int rc = ownTransaction ? easyDB.BeginTransaction() : SQLITE_OK;
+			for (size_t i = 0; SUCCESS(rc) && i < rows.size(); i++)
+				rc = Insert(rows[i]);
+			if (ownTransaction)
+			{
+				if (SUCCESS(rc))
+					rc = easyDB.CommitTransaction();
+				if (!SUCCESS(rc))
+					easyDB.RollbackTransaction();
+			}
+			return rc;
+		}
+
+		int Select(vector<Row> & rows)
+		{
+			int rc = Prepare(SelectSql(), selectStmt);
+			if (!SUCCESS(rc))
+				return rc;
+			while ((rc = sqlite3_step(selectStmt)) == SQLITE_ROW)
+			{
+				Row row;
+				RowBinder<Row, 0, sizeof...(Columns)>::Read(selectStmt, row);
+				rows.push_back(std::move(row));
+			}
+			sqlite3_reset(selectStmt);
+			return rc;
+		}
+
+	private:
+		Table(const Table &) = delete;
+		Table & operator=(const Table &) = delete;
+
+		static string BuildInsertSql()
+		{
+			const char* names[] = { Columns::Tag::SqlName()... };
+			string zSql = string("INSERT INTO ") + SqlName() + " (";
+			string params;
+			for (size_t i = 0; i < sizeof...(Columns); i++)
+			{
+				zSql += (i == 0 ? "" : ", ") + string(names[i]);
+				params += (i == 0 ? "?" : ",?");
+			}
+			return zSql + ") VALUES (" + params + ");";
+		}
+
+		static string BuildSelectSql()
+		{
+			const char* names[] = { Columns::Tag::SqlName()... };
+			string zSql("SELECT ");
+			for (size_t i = 0; i < sizeof...(Columns); i++)
+				zSql += (i == 0 ? "" : ", ") + string(names[i]);
+			return zSql + " FROM " + SqlName() + " ORDER BY RecordNumber;";
+		}
+
+		int Prepare(const string & zSql, sqlite3_stmt* &stmt)
+		{
+			if (stmt != NULL)
+				return SQLITE_OK;
+			return sqlite3_prepare_v2(easyDB.db, VALUE(zSql), LENGTH(zSql), &stmt, 0);
+		}
+
+		EasyDB & easyDB;
+		sqlite3_stmt* insertStmt;
+		sqlite3_stmt* selectStmt;
+	};
+}
+
+#endif
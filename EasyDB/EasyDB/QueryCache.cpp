@@ -0,0 +1,123 @@
+//  Created by Michael Valverde
+//  MIT Licensed Open Source Project
+//
+
+#include "QueryCache.h"
+
+using namespace openS3;
+
+QueryCache::QueryCache(size_t budget) : budget(budget), bytes(0)
+{
+	ResetStats();
+}
+
+void QueryCache::SetBudget(size_t budget)
+{
+	this->budget = budget;
+	Trim();
+}
+
+bool QueryCache::Lookup(const string & key, vector<string> & record)
+{
+	auto it = index.find(key);
+	if (it == index.end())
+	{
+		stats.misses++;
+		return false;
+	}
+	stats.hits++;
+	entries.splice(entries.begin(), entries, it->second);
+	record.insert(record.end(), it->second->record.begin(), it->second->record.end());
+	return true;
+}
+
+void QueryCache::Store(const string & table, const string & key, vector<string>::const_iterator first, vector<string>::const_iterator last)
+{
+	//key is held by the entry, the index and the table's key set
+	size_t size = sizeof(Entry) + table.size() + 3 * key.size();
+	for (auto value = first; value != last; ++value)
+		size += sizeof(string) + value->size();
+	if (size > budget)
+		return;
+
+	auto it = index.find(key);
+	if (it != index.end())
+		Erase(it->second);
+
+	Entry entry;
+	entry.table = table;
+	entry.key = key;
+	entry.record.assign(first, last);
+	entry.bytes = size;
+	entries.push_front(entry);
+	index[key] = entries.begin();
+	tableKeys[table].insert(key);
+	bytes += size;
+	Trim();
+}
+
+void QueryCache::Invalidate(const string & table)
+{
+	auto keys = tableKeys.find(table);
+	if (keys == tableKeys.end())
+		return;
+	for (auto & key : keys->second)
+	{
+		auto it = index.find(key);
+		bytes -= it->second->bytes;
+		entries.erase(it->second);
+		index.erase(it);
+		stats.invalidations++;
+	}
+	tableKeys.erase(keys);
+}
+
+void QueryCache::Erase(list<Entry>::iterator entry)
+{
+	auto keys = tableKeys.find(entry->table);
+	keys->second.erase(entry->key);
+	if (keys->second.empty())
+		tableKeys.erase(keys);
+	index.erase(entry->key);
+	bytes -= entry->bytes;
+	entries.erase(entry);
+}
+
+void QueryCache::Trim()
+{
+	while (!entries.empty() && bytes > budget)
+	{
+		Erase(--entries.end());
+		stats.evictions++;
+	}
+}
+
+void QueryCache::Clear()
+{
+	entries.clear();
+	index.clear();
+	tableKeys.clear();
+	bytes = 0;
+}
+
+void QueryCache::GetStats(QueryCacheStats & stats) const
+{
+	stats = this->stats;
+	unsigned long lookups = stats.hits + stats.misses;
+	stats.hitRatio = lookups > 0 ? (double)stats.hits / lookups : 0;
+	stats.entries = entries.size();
+	stats.bytes = bytes;
+	stats.budget = budget;
+}
+
+void QueryCache::ResetStats()
+{
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.evictions = 0;
+	stats.invalidations = 0;
+	stats.hitRatio = 0;
+	stats.entries = 0;
+	stats.bytes = 0;
+	stats.budget = 0;
+}
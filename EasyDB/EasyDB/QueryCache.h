@@ -0,0 +1,76 @@
+/*****************************************************************
+ * Created by Michael Valverde
+ * MIT Licensed Open Source Project
+ * LRU cache of query results for one connection, keyed by table,
+ * predicate and bound values, limited by an approximate memory
+ * budget. Entries are dropped per table when the table changes.
+ * Not thread safe: owned by a single EasyDB object.
+ ****************************************************************/
+#ifndef QueryCache_h
+#define QueryCache_h
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <set>
+
+using namespace std;
+
+namespace openS3
+{
+	struct QueryCacheStats
+	{
+		unsigned long hits;
+		unsigned long misses;
+		unsigned long evictions;		//entries dropped to stay within the budget
+		unsigned long invalidations;	//entries dropped because their table changed
+		double hitRatio;				//hits / (hits + misses)
+		size_t entries;
+		size_t bytes;					//approximate memory held by the entries
+		size_t budget;
+	};
+
+	class QueryCache
+	{
+	public:
+		explicit QueryCache(size_t budget = 0);
+
+		//A budget of 0 disables the cache and drops every entry
+		void SetBudget(size_t budget);
+		size_t GetBudget() const { return budget; }
+		//Appends the cached result of key to record; false on a miss
+		bool Lookup(const string & key, vector<string> & record);
+		//Caches the values appended from first on (results larger than the
+		//budget are not kept)
+		void Store(const string & table, const string & key, vector<string>::const_iterator first, vector<string>::const_iterator last);
+		//Drops every entry of the table (table key, as EasyDB::TableKey)
+		void Invalidate(const string & table);
+		void Clear();
+		void GetStats(QueryCacheStats & stats) const;
+		void ResetStats();
+
+	private:
+		struct Entry
+		{
+			string table;
+			string key;
+			vector<string> record;
+			size_t bytes;
+		};
+
+		QueryCache(const QueryCache &) = delete;
+		QueryCache & operator=(const QueryCache &) = delete;
+		void Erase(list<Entry>::iterator entry);
+		void Trim();
+
+		size_t budget;
+		size_t bytes;
+		list<Entry> entries;	//most recently used first
+		map<string, list<Entry>::iterator> index;
+		map<string, set<string>> tableKeys;
+		QueryCacheStats stats;
+	};
+}
+
+#endif
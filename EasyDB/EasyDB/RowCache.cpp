@@ -0,0 +1,207 @@
+//  Created by Michael Valverde
+//  MIT Licensed Open Source Project
+//
+
+#include "RowCache.h"
+
+using namespace openS3;
+
+RowCache::RowCache(size_t defaultCapacity, size_t shardCount) : shards(shardCount > 0 ? shardCount : 1), active(false), defaultCapacity(0)
+{
+	for (auto & shard : shards)
+	{
+		shard.version = 0;
+		shard.defaultCapacity = 0;
+	}
+	ResetStats();
+	SetDefaultCapacity(defaultCapacity);
+}
+
+RowCache::Shard & RowCache::ShardOf(const string & table, int64_t recordNumber)
+{
+	size_t hash = std::hash<string>()(table) ^ ((size_t)recordNumber * 0x9E3779B1u);
+	return shards[hash % shards.size()];
+}
+
+//A table's capacity is split evenly across the shards
+size_t RowCache::Capacity(const Shard & shard, const string & table)
+{
+	auto it = shard.capacities.find(table);
+	return it != shard.capacities.end() ? it->second : shard.defaultCapacity;
+}
+
+void RowCache::SetDefaultCapacity(size_t capacity)
+{
+	lock_guard<mutex> guard(capacityLock);
+	defaultCapacity = capacity;
+	size_t perShard = (capacity + shards.size() - 1) / shards.size();
+	for (auto & shard : shards)
+	{
+		lock_guard<mutex> lock(shard.lock);
+		shard.defaultCapacity = perShard;
+		for (auto & rows : shard.tables)
+		{
+			rows.second.capacity = Capacity(shard, rows.first);
+			Trim(shard, rows.second);
+		}
+	}
+	UpdateActive();
+}
+
+void RowCache::SetCapacity(const string & table, size_t capacity)
+{
+	lock_guard<mutex> guard(capacityLock);
+	capacities[table] = capacity;
+	size_t perShard = (capacity + shards.size() - 1) / shards.size();
+	for (auto & shard : shards)
+	{
+		lock_guard<mutex> lock(shard.lock);
+		shard.capacities[table] = perShard;
+		auto rows = shard.tables.find(table);
+		if (rows != shard.tables.end())
+		{
+			rows->second.capacity = perShard;
+			Trim(shard, rows->second);
+		}
+	}
+	UpdateActive();
+}
+
+void RowCache::UpdateActive()
+{
+	bool any = defaultCapacity > 0;
+	for (auto & capacity : capacities)
+		any = any || capacity.second > 0;
+	active = any;
+}
+
+bool RowCache::Lookup(const string & table, int64_t recordNumber, vector<string> & record, unsigned long long & version)
+{
+	Shard & shard = ShardOf(table, recordNumber);
+	lock_guard<mutex> lock(shard.lock);
+	version = shard.version;
+	auto rows = shard.tables.find(table);
+	if (rows != shard.tables.end())
+	{
+		auto it = rows->second.index.find(recordNumber);
+		if (it != rows->second.index.end())
+		{
+			shard.hits++;
+			rows->second.lru.splice(rows->second.lru.begin(), rows->second.lru, it->second);
+			record.insert(record.end(), it->second->second.begin(), it->second->second.end());
+			return true;
+		}
+	}
+	if (Capacity(shard, table) > 0)
+		shard.misses++;
+	return false;
+}
+
+void RowCache::Store(const string & table, int64_t recordNumber, unsigned long long version,
+	vector<string>::const_iterator first, vector<string>::const_iterator last)
+{
+	Shard & shard = ShardOf(table, recordNumber);
+	lock_guard<mutex> lock(shard.lock);
+	if (shard.version != version)
+		return;
+	auto rows = shard.tables.find(table);
+	if (rows == shard.tables.end())
+	{
+		size_t capacity = Capacity(shard, table);
+		if (capacity == 0)
+			return;
+		rows = shard.tables.insert(make_pair(table, TableRows())).first;
+		rows->second.capacity = capacity;
+	}
+	TableRows & tableRows = rows->second;
+	if (tableRows.capacity == 0 || tableRows.index.count(recordNumber) != 0)
+		return;
+	tableRows.lru.push_front(make_pair(recordNumber, vector<string>(first, last)));
+	tableRows.index[recordNumber] = tableRows.lru.begin();
+	Trim(shard, tableRows);
+}
+
+void RowCache::Trim(Shard & shard, TableRows & rows)
+{
+	while (rows.lru.size() > rows.capacity)
+	{
+		rows.index.erase(rows.lru.back().first);
+		rows.lru.pop_back();
+		shard.evictions++;
+	}
+}
+
+void RowCache::Invalidate(const string & table, int64_t recordNumber)
+{
+	Shard & shard = ShardOf(table, recordNumber);
+	lock_guard<mutex> lock(shard.lock);
+	shard.version++;
+	auto rows = shard.tables.find(table);
+	if (rows == shard.tables.end())
+		return;
+	auto it = rows->second.index.find(recordNumber);
+	if (it != rows->second.index.end())
+	{
+		rows->second.lru.erase(it->second);
+		rows->second.index.erase(it);
+		shard.invalidations++;
+	}
+}
+
+void RowCache::InvalidateTable(const string & table)
+{
+	for (auto & shard : shards)
+	{
+		lock_guard<mutex> lock(shard.lock);
+		shard.version++;
+		auto rows = shard.tables.find(table);
+		if (rows != shard.tables.end())
+		{
+			shard.invalidations += (unsigned long)rows->second.lru.size();
+			shard.tables.erase(rows);
+		}
+	}
+}
+
+void RowCache::Clear()
+{
+	for (auto & shard : shards)
+	{
+		lock_guard<mutex> lock(shard.lock);
+		shard.version++;
+		shard.tables.clear();
+	}
+}
+
+void RowCache::GetStats(RowCacheStats & stats) const
+{
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.evictions = 0;
+	stats.invalidations = 0;
+	stats.rows = 0;
+	for (auto & shard : shards)
+	{
+		lock_guard<mutex> lock(shard.lock);
+		stats.hits += shard.hits;
+		stats.misses += shard.misses;
+		stats.evictions += shard.evictions;
+		stats.invalidations += shard.invalidations;
+		for (auto & rows : shard.tables)
+			stats.rows += rows.second.lru.size();
+	}
+	unsigned long lookups = stats.hits + stats.misses;
+	stats.hitRatio = lookups > 0 ? (double)stats.hits / lookups : 0;
+}
+
+void RowCache::ResetStats()
+{
+	for (auto & shard : shards)
+	{
+		lock_guard<mutex> lock(shard.lock);
+		shard.hits = 0;
+		shard.misses = 0;
+		shard.evictions = 0;
+		shard.invalidations = 0;
+	}
+}
@@ -0,0 +1,98 @@
+/*****************************************************************
+ * Created by Michael Valverde
+ * MIT Licensed Open Source Project
+ * LRU cache of decoded rows keyed by (table, RecordNumber), split
+ * into shards with their own lock so it can be shared by the
+ * connections of an EasyDBPool. Capacity is set per table (rows).
+ * Each shard has a version that every invalidation bumps: a row read
+ * from the database is only stored if no invalidation hit its shard
+ * since the lookup that missed, so a reader racing a writer can't
+ * put an old row back.
+ ****************************************************************/
+#ifndef RowCache_h
+#define RowCache_h
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+using namespace std;
+
+namespace openS3
+{
+	struct RowCacheStats
+	{
+		unsigned long hits;
+		unsigned long misses;
+		unsigned long evictions;		//rows dropped to stay within a table's capacity
+		unsigned long invalidations;	//rows dropped because they changed
+		double hitRatio;				//hits / (hits + misses)
+		size_t rows;
+	};
+
+	class RowCache
+	{
+	public:
+		explicit RowCache(size_t defaultCapacity = 0, size_t shardCount = 16);
+
+		//Rows kept for tables without their own capacity (0 = not cached)
+		void SetDefaultCapacity(size_t capacity);
+		//Rows kept for one table (table key, as EasyDB::TableKey)
+		void SetCapacity(const string & table, size_t capacity);
+		//False when no table is cached, checked without locking
+		bool IsActive() const { return active; }
+		//Appends the cached row to record. On a miss version receives the value
+		//to pass to Store once the row has been read.
+		bool Lookup(const string & table, int64_t recordNumber, vector<string> & record, unsigned long long & version);
+		//Caches the values appended from first on, unless the row's shard was
+		//invalidated after the Lookup that returned version
+		void Store(const string & table, int64_t recordNumber, unsigned long long version,
+			vector<string>::const_iterator first, vector<string>::const_iterator last);
+		void Invalidate(const string & table, int64_t recordNumber);
+		void InvalidateTable(const string & table);
+		void Clear();
+		void GetStats(RowCacheStats & stats) const;
+		void ResetStats();
+
+	private:
+		struct TableRows
+		{
+			size_t capacity;
+			list<pair<int64_t, vector<string>>> lru;	//most recently used first
+			unordered_map<int64_t, list<pair<int64_t, vector<string>>>::iterator> index;
+		};
+
+		struct Shard
+		{
+			mutable mutex lock;
+			unsigned long long version;
+			size_t defaultCapacity;
+			map<string, size_t> capacities;
+			map<string, TableRows> tables;
+			unsigned long hits;
+			unsigned long misses;
+			unsigned long evictions;
+			unsigned long invalidations;
+		};
+
+		RowCache(const RowCache &) = delete;
+		RowCache & operator=(const RowCache &) = delete;
+		Shard & ShardOf(const string & table, int64_t recordNumber);
+		static size_t Capacity(const Shard & shard, const string & table);
+		static void Trim(Shard & shard, TableRows & rows);
+		void UpdateActive();
+
+		vector<Shard> shards;
+		atomic<bool> active;
+		mutex capacityLock;		//serializes capacity changes
+		size_t defaultCapacity;
+		map<string, size_t> capacities;
+	};
+}
+
+#endif
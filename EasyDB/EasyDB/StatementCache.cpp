@@ -0,0 +1,181 @@
+//  Created by Michael Valverde
+//  MIT Licensed Open Source Project
+//
+
+#include "StatementCache.h"
+#include <chrono>
+
+using namespace openS3;
+
+StatementCache::StatementCache(size_t capacity) : capacity(capacity)
+{
+	ResetStats();
+}
+
+StatementCache::~StatementCache()
+{
+	Clear();
+}
+
+string StatementCache::Normalize(const string & zSql)
+{
+	string key;
+	key.reserve(zSql.size());
+	char quote = 0;
+	bool pendingSpace = false;
+	for (size_t i = 0; i < zSql.size(); i++)
+	{
+		char ch = zSql[i];
+		if (quote != 0)
+		{
+			key += ch;
+			if (ch == quote)
+				quote = 0;
+			continue;
+		}
+		//comments count as whitespace: -- runs to the end of the line
+		if (ch == '-' && i + 1 < zSql.size() && zSql[i + 1] == '-')
+		{
+			size_t end = zSql.find('\n', i);
+			i = end == string::npos ? zSql.size() : end;
+			pendingSpace = !key.empty();
+			continue;
+		}
+		if (ch == '/' && i + 1 < zSql.size() && zSql[i + 1] == '*')
+		{
+			size_t end = zSql.find("*/", i + 2);
+			i = end == string::npos ? zSql.size() : end + 1;
+			pendingSpace = !key.empty();
+			continue;
+		}
+		if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r')
+		{
+			pendingSpace = !key.empty();
+			continue;
+		}
+		if (pendingSpace)
+			key += ' ';
+		pendingSpace = false;
+		if (ch == '\'' || ch == '"' || ch == '`')
+			quote = ch;
+		else if (ch == '[')
+			quote = ']';
+		key += ch;
+	}
+	while (!key.empty() && (key[key.size() - 1] == ';' || key[key.size() - 1] == ' '))
+		key.erase(key.size() - 1);
+	return key;
+}
+
+int StatementCache::Acquire(sqlite3* db, const string & zSql, sqlite3_stmt* &stmt)
+{
+	string key = Normalize(zSql);
+	auto it = index.find(key);
+	if (it != index.end())
+	{
+		Entry & entry = *it->second;
+		stmt = entry.stmt;
+		stats.hits++;
+		stats.compileMicrosSaved += entry.compileMicros;
+		checkedOut[stmt] = entry.compileMicros;
+		entries.erase(it->second);
+		index.erase(it);
+		return SQLITE_OK;
+	}
+
+	stats.misses++;
+	stmt = NULL;
+	auto start = std::chrono::steady_clock::now();
+	//the key is only for lookups; SQLite compiles the caller's text
+	int rc = sqlite3_prepare_v2(db, zSql.c_str(), (int)zSql.size(), &stmt, 0);
+	unsigned long long micros = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start).count();
+	stats.compileMicros += micros;
+	if (rc != SQLITE_OK || stmt == NULL)
+	{
+		sqlite3_finalize(stmt);
+		stmt = NULL;
+		return rc != SQLITE_OK ? rc : SQLITE_MISUSE;
+	}
+	checkedOut[stmt] = micros;
+	return rc;
+}
+
+void StatementCache::Release(const string & zSql, sqlite3_stmt* stmt)
+{
+	if (stmt == NULL)
+		return;
+	unsigned long long micros = 0;
+	auto out = checkedOut.find(stmt);
+	if (out != checkedOut.end())
+	{
+		micros = out->second;
+		checkedOut.erase(out);
+	}
+
+	//reset returns the error of the last step, if any
+	int rc = sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+	string key = Normalize(zSql);
+	if (rc == SQLITE_SCHEMA || rc == SQLITE_ERROR || capacity == 0 || index.count(key) != 0)
+	{
+		//schema changed under it, or a second copy of a statement that was
+		//checked out twice at the same time
+		if (rc == SQLITE_SCHEMA || rc == SQLITE_ERROR)
+			stats.evictions++;
+		sqlite3_finalize(stmt);
+		return;
+	}
+
+	Entry entry;
+	entry.key = key;
+	entry.stmt = stmt;
+	entry.compileMicros = micros;
+	entries.push_front(entry);
+	index[key] = entries.begin();
+	Trim();
+}
+
+void StatementCache::SetCapacity(size_t capacity)
+{
+	this->capacity = capacity;
+	Trim();
+}
+
+void StatementCache::Trim()
+{
+	while (entries.size() > capacity)
+	{
+		Entry & last = entries.back();
+		sqlite3_finalize(last.stmt);
+		index.erase(last.key);
+		entries.pop_back();
+		stats.evictions++;
+	}
+}
+
+void StatementCache::Clear()
+{
+	for (auto & entry : entries)
+		sqlite3_finalize(entry.stmt);
+	entries.clear();
+	index.clear();
+}
+
+void StatementCache::GetStats(StatementCacheStats & stats) const
+{
+	stats = this->stats;
+	stats.size = entries.size();
+	stats.capacity = capacity;
+}
+
+void StatementCache::ResetStats()
+{
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.evictions = 0;
+	stats.compileMicros = 0;
+	stats.compileMicrosSaved = 0;
+	stats.size = 0;
+	stats.capacity = 0;
+}
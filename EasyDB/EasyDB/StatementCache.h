@@ -0,0 +1,73 @@
+/*****************************************************************
+ * Created by Michael Valverde
+ * MIT Licensed Open Source Project
+ * LRU cache of compiled statements for one connection, keyed by
+ * normalized SQL text. Statements are checked out while in use and
+ * returned (reset, bindings cleared) when the caller is done, so a
+ * statement that is still stepping can never be evicted.
+ * Not thread safe: owned by a single EasyDB object.
+ ****************************************************************/
+#ifndef StatementCache_h
+#define StatementCache_h
+
+#include <string>
+#include <list>
+#include <map>
+#include "sqlite3.h"
+
+using namespace std;
+
+namespace openS3
+{
+	struct StatementCacheStats
+	{
+		unsigned long hits;
+		unsigned long misses;
+		unsigned long evictions;				//capacity and schema evictions
+		unsigned long long compileMicros;		//time spent compiling on misses
+		unsigned long long compileMicrosSaved;	//compile time of the statements reused on hits
+		size_t size;
+		size_t capacity;
+	};
+
+	class StatementCache
+	{
+	public:
+		explicit StatementCache(size_t capacity = 64);
+		~StatementCache();
+
+		//Collapses whitespace and comments outside quoted text/identifiers and
+		//drops trailing ';' so cosmetic differences share one entry
+		static string Normalize(const string & zSql);
+
+		//Checks the statement for zSql out of the cache, preparing it on a miss
+		int Acquire(sqlite3* db, const string & zSql, sqlite3_stmt* &stmt);
+		//Returns a checked out statement. Statements whose last step failed with
+		//SQLITE_SCHEMA/SQLITE_ERROR are finalized instead of cached.
+		void Release(const string & zSql, sqlite3_stmt* stmt);
+		void SetCapacity(size_t capacity);
+		void Clear();
+		void GetStats(StatementCacheStats & stats) const;
+		void ResetStats();
+
+	private:
+		struct Entry
+		{
+			string key;
+			sqlite3_stmt* stmt;
+			unsigned long long compileMicros;
+		};
+
+		StatementCache(const StatementCache &) = delete;
+		StatementCache & operator=(const StatementCache &) = delete;
+		void Trim();
+
+		size_t capacity;
+		list<Entry> entries;	//most recently used first
+		map<string, list<Entry>::iterator> index;
+		map<sqlite3_stmt*, unsigned long long> checkedOut;	//compile cost of statements in use
+		StatementCacheStats stats;
+	};
+}
+
+#endif
@@ -0,0 +1,694 @@
+//  Created by Michael Valverde
+//  MIT Licensed Open Source Project
+//
+//  Benchmarks for the EasyDB API and the equivalent raw sqlite3_* calls.
+//  usage: EasyDBBench [rows] [columns] [threads] [json|csv]
+//
+//  Every benchmark runs single threaded and with [threads] threads, each
+//  thread on its own connection to the same WAL database (Pool.* and
+//  Mutex.* share one EasyDBPool / one mutex-guarded EasyDB). Results are
+//  written to stdout as JSON (default) or CSV.
+//
+#include "../EasyDB/EasyDBAPI.h"
+#include "../EasyDB/EasyDBPool.h"
+#include "../EasyDB/EasyDBAsync.h"
+#include "../EasyDB/EasyDBGroupCommit.h"
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <random>
+#include <new>
+#include <stdlib.h>
+#include <stdio.h>
+using namespace std;
+using namespace openS3;
+
+//count every heap allocation made by the process
+static std::atomic<unsigned long long> allocations(0);
+
+void* operator new(size_t size)
+{
+	allocations++;
+	void* p = malloc(size != 0 ? size : 1);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p)
+{
+	free(p);
+}
+
+void operator delete[](void* p)
+{
+	operator delete(p);
+}
+
+//C++14 sized deallocation calls these instead
+void operator delete(void* p, size_t)
+{
+	operator delete(p);
+}
+
+void operator delete[](void* p, size_t)
+{
+	operator delete(p);
+}
+
+static const char* BenchDatabase = "EasyDBBench.db";
+static const char* BenchTable = "BENCHTABLE";
+
+struct BenchConfig
+{
+	int rows;
+	int columns;
+	int threads;
+	bool csv;
+};
+
+struct BenchResult
+{
+	string name;
+	string api;			//"easydb", "raw" or an easydb variant
+	int threads;
+	unsigned long ops;
+	double seconds;
+	double opsPerSecond;
+	double p50Micros;
+	double p99Micros;
+	double allocsPerOp;
+	double allocsPerRow;
+};
+
+//Per-thread connections; each benchmark thread gets its own
+struct Worker
+{
+	Worker() : raw(NULL) {}
+	~Worker() { sqlite3_close_v2(raw); }
+
+	int id;
+	EasyDB db;
+	sqlite3* raw;
+	std::minstd_rand random;
+	vector<string> record;
+	vector<vector<string>> records;
+};
+
+typedef std::function<void(Worker &, int)> BenchOp;
+
+static vector<BenchResult> results;
+
+static vector<string> MakeRecord(const BenchConfig & config, int row)
+{
+	vector<string> record;
+	for (int c = 0; c < config.columns; c++)
+		record.push_back("value_" + to_string(row) + "_" + to_string(c));
+	return record;
+}
+
+static void CreateSyntheticTable(const BenchConfig & config, int rows)
+{
+	EasyDB db;
+	db.InitializeDatabase(BenchDatabase, "", OpenOptions::FromProfile(ProfileBalanced));
+	vector<string> fields;
+	for (int c = 0; c < config.columns; c++)
+		fields.push_back("Field" + to_string(c));
+	db.CreateTable(BenchTable, fields, true);
+
+	vector<vector<string>> records;
+	for (int r = 0; r < rows; r++)
+		records.push_back(MakeRecord(config, r));
+	db.AddRecords(BenchTable, records);
+}
+
+static double Percentile(vector<double> & sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+	size_t index = (size_t)(p * (sorted.size() - 1));
+	return sorted[index];
+}
+
+//Runs opsPerThread calls of op on each of the threads and records one result;
+//rowsPerOp is the number of rows each call reads (for allocations per row)
+static void Run(const string & name, const string & api, int threads,
+				int opsPerThread, const BenchOp & op, int rowsPerOp = 1)
+{
+	vector<unique_ptr<Worker>> workers;
+	vector<vector<double>> latencies(threads);
+	for (int t = 0; t < threads; t++)
+	{
+		unique_ptr<Worker> worker(new Worker);
+		worker->id = t;
+		worker->random.seed(t + 1);
+		worker->db.InitializeDatabase(BenchDatabase, "", OpenOptions::FromProfile(ProfileBalanced));
+		sqlite3_open_v2(BenchDatabase, &worker->raw, SQLITE_OPEN_READWRITE, NULL);
+		sqlite3_busy_timeout(worker->raw, 5000);
+		//same settings as ProfileBalanced so only the wrapper differs
+		sqlite3_exec(worker->raw, "PRAGMA synchronous = NORMAL; PRAGMA cache_size = -65536;"
+			"PRAGMA temp_store = 2; PRAGMA mmap_size = 268435456;", NULL, NULL, NULL);
+		workers.push_back(std::move(worker));
+		latencies[t].reserve(opsPerThread);
+	}
+
+	std::atomic<int> ready(0);
+	std::atomic<bool> go(false);
+	vector<std::thread> pool;
+	for (int t = 0; t < threads; t++)
+	{
+		pool.push_back(std::thread([&, t]()
+		{
+			Worker & worker = *workers[t];
+			ready++;
+			while (!go)
+				std::this_thread::yield();
+			for (int i = 0; i < opsPerThread; i++)
+			{
+				auto start = std::chrono::steady_clock::now();
+				op(worker, i);
+				latencies[t].push_back(std::chrono::duration<double, std::micro>(
+					std::chrono::steady_clock::now() - start).count());
+			}
+		}));
+	}
+	while (ready < threads)
+		std::this_thread::yield();
+
+	unsigned long long allocsBefore = allocations;
+	auto start = std::chrono::steady_clock::now();
+	go = true;
+	for (auto & thread : pool)
+		thread.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	unsigned long long allocs = allocations - allocsBefore;
+
+	vector<double> all;
+	for (auto & l : latencies)
+		all.insert(all.end(), l.begin(), l.end());
+	std::sort(all.begin(), all.end());
+
+	BenchResult result;
+	result.name = name;
+	result.api = api;
+	result.threads = threads;
+	result.ops = (unsigned long)all.size();
+	result.seconds = seconds;
+	result.opsPerSecond = seconds > 0 ? result.ops / seconds : 0;
+	result.p50Micros = Percentile(all, 0.50);
+	result.p99Micros = Percentile(all, 0.99);
+	result.allocsPerOp = result.ops > 0 ? (double)allocs / result.ops : 0;
+	result.allocsPerRow = result.allocsPerOp / rowsPerOp;
+	results.push_back(result);
+}
+
+//Point lookups of Field1 by Field0 with a plain index on Field0 (one index
+//seek plus a table lookup) and with a covering index on (Field0, Field1)
+static void BenchCoveringIndex(const BenchConfig & config, int threads)
+{
+	if (config.columns < 2)
+		return;
+	CreateSyntheticTable(config, config.rows);
+	int lookups = config.rows / threads;
+	vector<string> columns(1, "Field1");
+	BenchOp lookup = [&](Worker & w, int)
+	{
+		vector<FieldValue> key(1, FieldValue("value_" + to_string(w.random() % config.rows) + "_0"));
+		w.record.clear();
+		w.db.GetRecord(BenchTable, columns, "Field0 = ?", key, w.record);
+	};
+
+	EasyDB db;
+	db.InitializeDatabase(BenchDatabase, "", OpenOptions::FromProfile(ProfileBalanced));
+	IndexDef plain = IndexDef().Column("Field0");
+	db.AddIndex(BenchTable, plain);
+	Run("GetRecord.Index", "easydb", threads, lookups, lookup);
+	db.RemoveIndex(BenchTable, plain);
+
+	IndexDef covering = IndexDef().Column("Field0").Include("Field1");
+	db.AddIndex(BenchTable, covering);
+	Run("GetRecord.CoveringIndex", "easydb", threads, lookups, lookup);
+	db.RemoveIndex(BenchTable, covering);
+}
+
+//Indexed lookups that keep repeating a small hot set of predicates, without
+//and with the query result cache
+static void BenchQueryCache(const BenchConfig & config, int threads)
+{
+	CreateSyntheticTable(config, config.rows);
+	int lookups = config.rows / threads;
+	int hotKeys = std::min(config.rows, 64);
+	BenchOp lookup = [&](Worker & w, int)
+	{
+		vector<FieldValue> key(1, FieldValue("value_" + to_string(w.random() % hotKeys) + "_0"));
+		w.record.clear();
+		w.db.GetRecord(BenchTable, "Field0 = ?", key, w.record);
+	};
+
+	EasyDB db;
+	db.InitializeDatabase(BenchDatabase, "", OpenOptions::FromProfile(ProfileBalanced));
+	db.AddIndex(BenchTable, IndexDef().Column("Field0"));
+	Run("GetRecord.HotPredicate", "easydb", threads, lookups, lookup);
+	Run("GetRecord.HotPredicate", "easydb-querycache", threads, lookups, [&](Worker & w, int i)
+	{
+		if (i == 0)
+			w.db.EnableQueryCache(4 * 1024 * 1024);
+		lookup(w, i);
+	});
+}
+
+//Lookups through one shared EasyDBPool (one reader per thread) against one
+//shared EasyDB behind a mutex, the way callers had to serialize before the pool
+static void BenchPool(const BenchConfig & config, int threads)
+{
+	CreateSyntheticTable(config, config.rows);
+	int lookups = config.rows / threads;
+
+	EasyDBPool pool;
+	pool.Initialize(BenchDatabase, "", (size_t)threads);
+	Run("Pool.GetRecord", "easydb", threads, lookups, [&](Worker & w, int)
+	{
+		vector<string> record;
+		pool.GetRecord(BenchTable, (int)(w.random() % config.rows) + 1, record);
+	});
+
+	EasyDB shared;
+	shared.InitializeDatabase(BenchDatabase, "", OpenOptions::FromProfile(ProfileBalanced));
+	std::mutex sharedMutex;
+	Run("Mutex.GetRecord", "easydb", threads, lookups, [&](Worker & w, int)
+	{
+		vector<string> record;
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		shared.GetRecord(BenchTable, (int)(w.random() % config.rows) + 1, record);
+	});
+}
+
+//Single-row inserts through the async writer; each caller waits for its own
+//commit, so concurrent callers end up sharing transactions
+static void BenchAsync(const BenchConfig & config, int threads)
+{
+	CreateSyntheticTable(config, 0);
+	int ops = config.rows / threads;
+	EasyDBAsync async;
+	async.Initialize(BenchDatabase, "", 1);
+	Run("AddRecordAsync", "easydb", threads, ops, [&](Worker &, int i)
+	{
+		async.AddRecordAsync(BenchTable, MakeRecord(config, i)).wait();
+	});
+}
+
+//Single-row inserts from every thread through one group-committing connection
+static void BenchGroupCommit(const BenchConfig & config, int threads)
+{
+	CreateSyntheticTable(config, 0);
+	int ops = config.rows / threads;
+	EasyDB shared;
+	shared.InitializeDatabase(BenchDatabase, "", OpenOptions::FromProfile(ProfileBalanced));
+	EasyDBGroupCommit group(shared);
+	Run("GroupCommit.AddRecord", "easydb", threads, ops, [&](Worker &, int i)
+	{
+		group.AddRecord(BenchTable, MakeRecord(config, i));
+	});
+}
+
+//Raw sqlite3 helpers, prepared per call like a caller without EasyDB would
+//have to (minus the string building EasyDB does on top)
+static void RawExec(sqlite3* raw, const string & zSql, const vector<string> & values)
+{
+	sqlite3_stmt* stmt = NULL;
+	if (sqlite3_prepare_v2(raw, VALUE(zSql), LENGTH(zSql), &stmt, 0) == SQLITE_OK)
+	{
+		for (size_t i = 0; i < values.size(); i++)
+			sqlite3_bind_text(stmt, (int)i + 1, VALUE(values[i]), LENGTH(values[i]), SQLITE_STATIC);
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+		{
+			int cols = sqlite3_column_count(stmt);
+			for (int col = 0; col < cols; col++)
+				sqlite3_column_text(stmt, col);
+		}
+	}
+	sqlite3_finalize(stmt);
+}
+
+static string RawInsertSql(const BenchConfig & config)
+{
+	string zSql = string("INSERT INTO ") + BenchTable + " (";
+	string params;
+	for (int c = 0; c < config.columns; c++)
+	{
+		zSql += (c == 0 ? "Field" : ", Field") + to_string(c);
+		params += (c == 0 ? "?" : ",?");
+	}
+	return zSql + ") VALUES (" + params + ");";
+}
+
+static void BenchInserts(const BenchConfig & config, int threads)
+{
+	int ops = config.rows / threads;
+	CreateSyntheticTable(config, 0);
+	Run("AddRecord", "easydb", threads, ops, [&](Worker & w, int i)
+	{
+		w.db.AddRecord(BenchTable, MakeRecord(config, i));
+	});
+
+	CreateSyntheticTable(config, 0);
+	string insertSql = RawInsertSql(config);
+	Run("AddRecord", "raw", threads, ops, [&](Worker & w, int i)
+	{
+		RawExec(w.raw, insertSql, MakeRecord(config, i));
+	});
+
+	const int batchSize = 1000;
+	int batches = std::max(1, ops / batchSize);
+	CreateSyntheticTable(config, 0);
+	Run("AddRecords", "easydb", threads, batches, [&](Worker & w, int)
+	{
+		if (w.records.empty())
+			for (int r = 0; r < batchSize; r++)
+				w.records.push_back(MakeRecord(config, r));
+		w.db.AddRecords(BenchTable, w.records);
+	});
+
+	CreateSyntheticTable(config, 0);
+	Run("AddRecords", "raw", threads, batches, [&](Worker & w, int)
+	{
+		if (w.records.empty())
+			for (int r = 0; r < batchSize; r++)
+				w.records.push_back(MakeRecord(config, r));
+		sqlite3_exec(w.raw, "BEGIN;", NULL, NULL, NULL);
+		sqlite3_stmt* stmt = NULL;
+		sqlite3_prepare_v2(w.raw, VALUE(insertSql), LENGTH(insertSql), &stmt, 0);
+		for (auto & record : w.records)
+		{
+			for (size_t c = 0; c < record.size(); c++)
+				sqlite3_bind_text(stmt, (int)c + 1, VALUE(record[c]), LENGTH(record[c]), SQLITE_STATIC);
+			sqlite3_step(stmt);
+			sqlite3_reset(stmt);
+		}
+		sqlite3_finalize(stmt);
+		sqlite3_exec(w.raw, "COMMIT;", NULL, NULL, NULL);
+	});
+}
+
+static void BenchReads(const BenchConfig & config, int threads)
+{
+	CreateSyntheticTable(config, config.rows);
+	int scans = std::max(1, 20 / threads);
+	Run("GetRecords", "easydb", threads, scans, [&](Worker & w, int)
+	{
+		vector<vector<string>> records;
+		w.db.GetRecords(BenchTable, records);
+	}, config.rows);
+
+	string selectAll = string("SELECT * FROM ") + BenchTable + ";";
+	Run("GetRecords", "raw", threads, scans, [&](Worker & w, int)
+	{
+		RawExec(w.raw, selectAll, vector<string>());
+	}, config.rows);
+
+	Run("Cursor.GetRow", "easydb", threads, scans, [&](Worker & w, int)
+	{
+		EasyDB::Cursor cursor;
+		w.db.Scan(BenchTable, cursor);
+		while (cursor.Next() == SQLITE_ROW)
+		{
+			w.record.clear();
+			cursor.GetRow(w.record);
+		}
+	}, config.rows);
+
+	Run("Cursor.GetRowView", "easydb", threads, scans, [&](Worker & w, int)
+	{
+		size_t bytes = 0;
+		EasyDB::Cursor cursor;
+		w.db.Scan(BenchTable, cursor);
+		while (cursor.Next() == SQLITE_ROW)
+			bytes += cursor.GetRowView().GetText(1).Size();
+	}, config.rows);
+
+	//whole table in pages of 100: keyset seek vs LIMIT/OFFSET
+	const int pageSize = 100;
+	Run("GetPage", "easydb", threads, scans, [&](Worker & w, int)
+	{
+		long long after = 0;
+		while (true)
+		{
+			w.records.clear();
+			w.db.GetPage(BenchTable, after, pageSize, w.records);
+			if (w.records.empty())
+				break;
+			after = atoll(w.records.back()[0].c_str());
+		}
+	}, config.rows);
+
+	string selectPage = string("SELECT * FROM ") + BenchTable + " ORDER BY RecordNumber LIMIT ? OFFSET ?;";
+	Run("GetPage", "raw", threads, scans, [&](Worker & w, int)
+	{
+		for (int offset = 0; offset < config.rows; offset += pageSize)
+		{
+			vector<string> page;
+			page.push_back(to_string(pageSize));
+			page.push_back(to_string(offset));
+			RawExec(w.raw, selectPage, page);
+		}
+	}, config.rows);
+
+	int lookups = config.rows / threads;
+	Run("GetRecord", "easydb", threads, lookups, [&](Worker & w, int)
+	{
+		vector<string> record;
+		w.db.GetRecord(BenchTable, (int)(w.random() % config.rows) + 1, record);
+	});
+
+	//100-row RecordNumber windows streamed from a cached statement
+	const int window = 100;
+	Run("ScanRange", "easydb", threads, lookups, [&](Worker & w, int)
+	{
+		long long lo = w.random() % config.rows + 1;
+		size_t bytes = 0;
+		w.db.ScanRange(BenchTable, "RecordNumber", RangeBound(FieldValue(lo)), RangeBound(FieldValue(lo + window), false),
+			[&](const RowView & row) { bytes += row.GetText(1).Size(); return true; });
+	}, window);
+
+	string selectWindow = string("SELECT * FROM ") + BenchTable + " WHERE RecordNumber >= ? AND RecordNumber < ?;";
+	Run("ScanRange", "raw", threads, lookups, [&](Worker & w, int)
+	{
+		long long lo = w.random() % config.rows + 1;
+		vector<string> bounds;
+		bounds.push_back(to_string(lo));
+		bounds.push_back(to_string(lo + window));
+		RawExec(w.raw, selectWindow, bounds);
+	}, window);
+
+	//500 random rows per op: one multi-get against 500 single lookups
+	const int batchKeys = 500;
+	int multiGets = std::max(1, lookups / batchKeys);
+	Run("GetRecords.MultiGet", "easydb", threads, multiGets, [&](Worker & w, int)
+	{
+		vector<int64_t> keys;
+		for (int k = 0; k < batchKeys; k++)
+			keys.push_back(w.random() % config.rows + 1);
+		vector<bool> found;
+		w.records.clear();
+		w.db.GetRecords(BenchTable, keys, w.records, found);
+	}, batchKeys);
+
+	Run("GetRecords.MultiGet", "easydb-loop", threads, multiGets, [&](Worker & w, int)
+	{
+		for (int k = 0; k < batchKeys; k++)
+		{
+			w.record.clear();
+			w.db.GetRecord(BenchTable, (int)(w.random() % config.rows) + 1, w.record);
+		}
+	}, batchKeys);
+
+	int counts = std::max(1, 1000 / threads);
+	Run("GetNumRows", "easydb", threads, counts, [&](Worker & w, int)
+	{
+		w.db.GetNumRows(BenchTable);
+	});
+
+	Run("GetNumRows", "easydb-cached", threads, counts, [&](Worker & w, int i)
+	{
+		if (i == 0)
+			w.db.EnableRowCountCache(true);
+		w.db.GetNumRows(BenchTable);
+	});
+
+	//the same lookups over a working set of 1000 rows, without and with the row cache
+	int hotRows = std::min(config.rows, 1000);
+	Run("GetRecord.HotRows", "easydb", threads, lookups, [&](Worker & w, int)
+	{
+		w.record.clear();
+		w.db.GetRecord(BenchTable, (int)(w.random() % hotRows) + 1, w.record);
+	});
+
+	Run("GetRecord.HotRows", "easydb-rowcache", threads, lookups, [&](Worker & w, int i)
+	{
+		if (i == 0)
+			w.db.EnableRowCache(hotRows);
+		w.record.clear();
+		w.db.GetRecord(BenchTable, (int)(w.random() % hotRows) + 1, w.record);
+	});
+
+	string selectOne = string("SELECT * FROM ") + BenchTable + " WHERE RecordNumber = ?;";
+	Run("GetRecord", "raw", threads, lookups, [&](Worker & w, int)
+	{
+		vector<string> key(1, to_string(w.random() % config.rows + 1));
+		RawExec(w.raw, selectOne, key);
+	});
+}
+
+//Rewriting existing rows: in-place UpdateRecord against the delete + add
+//callers used before, which also moves the row to a new RecordNumber
+static void BenchUpdates(const BenchConfig & config, int threads)
+{
+	int ops = config.rows / threads;
+	vector<string> columns(1, "Field0");
+	CreateSyntheticTable(config, config.rows);
+	Run("UpdateRecord", "easydb", threads, ops, [&](Worker & w, int i)
+	{
+		vector<FieldValue> values(1, FieldValue("updated_" + to_string(i)));
+		vector<FieldValue> key(1, FieldValue((long long)(w.id * ops + i + 1)));
+		w.db.UpdateRecord(BenchTable, columns, values, "RecordNumber = ?", key);
+	});
+
+	CreateSyntheticTable(config, config.rows);
+	Run("UpdateRecord", "easydb-delete-add", threads, ops, [&](Worker & w, int i)
+	{
+		vector<FieldValue> key(1, FieldValue((long long)(w.id * ops + i + 1)));
+		w.db.DeleteRecord(BenchTable, "RecordNumber = ?", key);
+		w.db.AddRecord(BenchTable, MakeRecord(config, i));
+	});
+
+	//whole table upserted on a unique Field0 in batches of 1000
+	const int batchSize = 1000;
+	int batches = std::max(1, ops / batchSize);
+	CreateSyntheticTable(config, config.rows);
+	{
+		EasyDB db;
+		db.InitializeDatabase(BenchDatabase, "", OpenOptions::FromProfile(ProfileBalanced));
+		db.AddIndex(BenchTable, IndexDef().Column("Field0").Unique());
+	}
+	Run("UpsertRecords", "easydb", threads, batches, [&](Worker & w, int i)
+	{
+		vector<vector<FieldValue>> rows;
+		for (int r = 0; r < batchSize; r++)
+		{
+			vector<string> record = MakeRecord(config, (w.id * batches + i) * batchSize + r);
+			vector<FieldValue> row;
+			for (auto & value : record)
+				row.push_back(FieldValue(value));
+			rows.push_back(row);
+		}
+		w.db.UpsertRecords(BenchTable, columns, rows);
+	});
+}
+
+static void BenchDeletes(const BenchConfig & config, int threads)
+{
+	int ops = config.rows / threads;
+	CreateSyntheticTable(config, config.rows);
+	Run("DeleteRecord", "easydb", threads, ops, [&](Worker & w, int i)
+	{
+		w.db.DeleteRecord(BenchTable, "RecordNumber = " + to_string(w.id * ops + i + 1));
+	});
+
+	CreateSyntheticTable(config, config.rows);
+	string deleteOne = string("DELETE FROM ") + BenchTable + " WHERE RecordNumber = ?;";
+	Run("DeleteRecord", "raw", threads, ops, [&](Worker & w, int i)
+	{
+		vector<string> key(1, to_string(w.id * ops + i + 1));
+		RawExec(w.raw, deleteOne, key);
+	});
+
+	//the same rows purged as key lists of 1000 in chunks of 10000 rows per transaction
+	const int batchSize = 1000;
+	int batches = std::max(1, ops / batchSize);
+	CreateSyntheticTable(config, config.rows);
+	Run("DeleteRecords.Chunked", "easydb", threads, batches, [&](Worker & w, int i)
+	{
+		vector<int64_t> keys;
+		for (int k = 0; k < batchSize; k++)
+			keys.push_back((int64_t)w.id * ops + (int64_t)i * batchSize + k + 1);
+		w.db.DeleteRecords(BenchTable, keys);
+	});
+
+	CreateSyntheticTable(config, config.rows);
+	Run("DeleteRange", "easydb", threads, batches, [&](Worker & w, int i)
+	{
+		long long lo = (long long)w.id * ops + (long long)i * batchSize + 1;
+		w.db.DeleteRange(BenchTable, "RecordNumber", RangeBound(FieldValue(lo)), RangeBound(FieldValue(lo + batchSize), false));
+	});
+}
+
+static void WriteResults(const BenchConfig & config)
+{
+	if (config.csv)
+	{
+		printf("name,api,threads,rows,columns,ops,seconds,ops_per_sec,p50_us,p99_us,allocs_per_op,allocs_per_row\n");
+		for (auto & r : results)
+			printf("%s,%s,%d,%d,%d,%lu,%.6f,%.1f,%.2f,%.2f,%.2f,%.4f\n", r.name.c_str(), r.api.c_str(), r.threads,
+				config.rows, config.columns, r.ops, r.seconds, r.opsPerSecond, r.p50Micros, r.p99Micros, r.allocsPerOp,
+				r.allocsPerRow);
+		return;
+	}
+
+	printf("{\n  \"rows\": %d,\n  \"columns\": %d,\n  \"results\": [\n", config.rows, config.columns);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult & r = results[i];
+		printf("    {\"name\": \"%s\", \"api\": \"%s\", \"threads\": %d, \"ops\": %lu, \"seconds\": %.6f, "
+			"\"ops_per_sec\": %.1f, \"p50_us\": %.2f, \"p99_us\": %.2f, \"allocs_per_op\": %.2f, \"allocs_per_row\": %.4f}%s\n",
+			r.name.c_str(), r.api.c_str(), r.threads, r.ops, r.seconds, r.opsPerSecond, r.p50Micros,
+			r.p99Micros, r.allocsPerOp, r.allocsPerRow, i + 1 < results.size() ? "," : "");
+	}
+	printf("  ]\n}\n");
+}
+
+int main(int argc, const char * argv[])
+{
+	BenchConfig config;
+	config.rows = argc > 1 ? atoi(argv[1]) : 10000;
+	config.columns = argc > 2 ? atoi(argv[2]) : 8;
+	config.threads = argc > 3 ? atoi(argv[3]) : (int)std::max(1u, std::thread::hardware_concurrency());
+	config.csv = argc > 4 && string(argv[4]) == "csv";
+	if (config.rows < 1 || config.columns < 1 || config.threads < 1)
+	{
+		fprintf(stderr, "usage: EasyDBBench [rows] [columns] [threads] [json|csv]\n");
+		return 1;
+	}
+
+	vector<int> threadCounts(1, 1);
+	if (config.threads > 1)
+		threadCounts.push_back(config.threads);
+
+	for (int threads : threadCounts)
+	{
+		BenchInserts(config, threads);
+		BenchReads(config, threads);
+		BenchUpdates(config, threads);
+		BenchDeletes(config, threads);
+		BenchCoveringIndex(config, threads);
+		BenchQueryCache(config, threads);
+		BenchPool(config, threads);
+		BenchAsync(config, threads);
+		BenchGroupCommit(config, threads);
+	}
+
+	EasyDB db;
+	db.InitializeDatabase(BenchDatabase, "");
+	db.DeleteTable(BenchTable);
+
+	WriteResults(config);
+	return 0;
+}